@@ -0,0 +1,224 @@
+/**
+ * @file callback_dispatch.cpp
+ * @brief Per-message callback cost of epoll_server vs static_epoll_server
+ *
+ * Two measurements:
+ * 1. Dispatch only: the read path's hand-off of one received chunk to the
+ *    application, repeated in a tight loop. A virtual server overriding
+ *    the shared_ptr callback pays two indirect calls and a shared_ptr copy
+ *    (two atomic operations); one overriding the connection_handle
+ *    callback pays one indirect call; the static server calls the handler
+ *    directly with a reference.
+ * 2. Echo round trips over loopback, one message in flight, for both
+ *    servers. This shows how much of a real message's cost the dispatch is.
+ *
+ * Build with -DBENCHMARKS=ON; run ./callback_dispatch_bench [messages].
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../includes/epoll_server.hpp"
+#include "../includes/static_epoll_server.hpp"
+#include "../includes/utilities.hpp"
+
+using namespace hh_socket;
+
+namespace
+{
+    /// Stands in for the loop: the dispatch type is known, the server object is not
+    template <class Dispatch>
+    __attribute__((noinline)) void drive(Dispatch &dispatch, epoll_connection &c, const data_buffer &db, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            dispatch.message(c, db);
+    }
+
+    class virtual_echo : public epoll_server
+    {
+    public:
+        uint64_t bytes = 0;
+        bool echo = false;
+
+        virtual_echo() : epoll_server(1024) {}
+
+        void deliver(const std::shared_ptr<connection> &conn, const data_buffer &db, std::size_t n)
+        {
+            epoll_connection &c = conns.emplace(conn->get_fd());
+            c.conn = conn;
+            virtual_dispatch dispatch{*this};
+            drive(dispatch, c, db, n);
+            conns.erase(conn->get_fd());
+        }
+
+    protected:
+        void on_message_received(std::shared_ptr<connection> conn, const data_buffer &db) override
+        {
+            bytes += db.size();
+            if (echo)
+                send_message(conn, db);
+        }
+
+        void on_connection_opened(std::shared_ptr<connection>) override {}
+        void on_connection_closed(std::shared_ptr<connection>) override {}
+        void on_listen_success() override {}
+        void on_shutdown_success() override {}
+    };
+
+    class handle_echo : public epoll_server
+    {
+    public:
+        uint64_t bytes = 0;
+        bool echo = false;
+
+        handle_echo() : epoll_server(1024) {}
+
+        void deliver(const std::shared_ptr<connection> &conn, const data_buffer &db, std::size_t n)
+        {
+            epoll_connection &c = conns.emplace(conn->get_fd());
+            c.conn = conn;
+            virtual_dispatch dispatch{*this};
+            drive(dispatch, c, db, n);
+            conns.erase(conn->get_fd());
+        }
+
+    protected:
+        void on_message_received(connection_handle h, const data_buffer &db) override
+        {
+            bytes += db.size();
+            if (echo)
+                send_message(h, db);
+        }
+
+        void on_connection_opened(std::shared_ptr<connection>) override {}
+        void on_connection_closed(std::shared_ptr<connection>) override {}
+        void on_listen_success() override {}
+        void on_shutdown_success() override {}
+    };
+
+    class static_echo : public static_epoll_server<static_echo>
+    {
+    public:
+        uint64_t bytes = 0;
+        bool echo = false;
+
+        static_echo() : static_epoll_server(1024) {}
+
+        void deliver(const std::shared_ptr<connection> &conn, const data_buffer &db, std::size_t n)
+        {
+            epoll_connection &c = conns.emplace(conn->get_fd());
+            c.conn = conn;
+            static_dispatch dispatch{*this};
+            drive(dispatch, c, db, n);
+            conns.erase(conn->get_fd());
+        }
+
+        void on_message(connection &conn, const data_buffer &db)
+        {
+            bytes += db.size();
+            if (echo)
+                send_message(conn, db);
+        }
+    };
+
+    double seconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    template <class Server>
+    double dispatch_ns(Server &server, std::size_t n)
+    {
+        int fds[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        auto conn = std::make_shared<connection>(file_descriptor(fds[0]), socket_address(), socket_address());
+        data_buffer db(std::string(64, 'x'));
+
+        server.deliver(conn, db, n / 10); // warm up
+        auto start = std::chrono::steady_clock::now();
+        server.deliver(conn, db, n);
+        double ns = seconds_since(start) * 1e9 / static_cast<double>(n);
+        ::close(fds[1]);
+        if (server.bytes != (n + n / 10) * db.size())
+            std::cerr << "callbacks missed\n";
+        return ns;
+    }
+
+    template <class Server>
+    double round_trip_us(Server &server, uint16_t port, std::size_t n)
+    {
+        server.echo = true;
+        server.register_listener_socket(make_listener_socket(port, "127.0.0.1", 128));
+        std::thread loop([&]
+                         { server.listen(100); });
+
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        while (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        char msg[64] = {};
+        char reply[64];
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            ::send(fd, msg, sizeof(msg), 0);
+            std::size_t got = 0;
+            while (got < sizeof(reply))
+            {
+                ssize_t r = ::recv(fd, reply + got, sizeof(reply) - got, 0);
+                if (r <= 0)
+                    break;
+                got += static_cast<std::size_t>(r);
+            }
+        }
+        double us = seconds_since(start) * 1e6 / static_cast<double>(n);
+
+        ::close(fd);
+        server.stop_server();
+        loop.join();
+        return us;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000000;
+    std::size_t round_trips = messages / 500;
+
+    // libstdc++ skips the atomic reference counting until the process has
+    // started a thread; servers always have (loop threads, workers)
+    std::thread([] {}).join();
+
+    virtual_echo v;
+    handle_echo h;
+    static_echo s;
+    double v_ns = dispatch_ns(v, messages);
+    double h_ns = dispatch_ns(h, messages);
+    double s_ns = dispatch_ns(s, messages);
+    std::cout << "dispatch, ns per message:   virtual " << v_ns << "   handle " << h_ns << "   static " << s_ns << '\n';
+
+    virtual_echo v2;
+    handle_echo h2;
+    static_echo s2;
+    double v_us = round_trip_us(v2, 19401, round_trips);
+    double h_us = round_trip_us(h2, 19403, round_trips);
+    double s_us = round_trip_us(s2, 19402, round_trips);
+    std::cout << "echo round trip, us:        virtual " << v_us << "   handle " << h_us << "   static " << s_us << '\n';
+    return 0;
+}
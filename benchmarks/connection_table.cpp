@@ -0,0 +1,146 @@
+/**
+ * @file connection_table.cpp
+ * @brief fd lookup and open/close churn: connection_table vs std::unordered_map
+ *
+ * epoll_server used to keep its epoll_connection states in a
+ * std::unordered_map<int, epoll_connection>. Both containers are filled
+ * with the same number of connections on consecutive fds (as the kernel
+ * hands them out) and measured on:
+ * 1. Lookup: find() of a random live fd, as on every epoll event.
+ * 2. Churn: close then open on a random fd. The map does what the old
+ *    close_conn()/accept path did (operator[], erase, emplace); the table
+ *    does erase + emplace, and retire + revive as the pooled close path does.
+ *
+ * Build with -DBENCHMARKS=ON; run ./connection_table_bench [connections] [operations].
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "../includes/connection_table.hpp"
+#include "../includes/epoll_server.hpp"
+
+using namespace hh_socket;
+
+namespace
+{
+    /// First fd handed to a client; below are stdio, the listener, epoll and eventfd
+    constexpr int FIRST_FD = 8;
+
+    double seconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /// Keeps a value alive so the measured loop is not optimized away
+    template <class T>
+    void keep(const T &value) { asm volatile("" : : "r,m"(value) : "memory"); }
+
+    std::vector<int> random_fds(std::size_t connections, std::size_t n)
+    {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> pick(FIRST_FD, FIRST_FD + static_cast<int>(connections) - 1);
+        std::vector<int> fds(n);
+        for (int &fd : fds)
+            fd = pick(rng);
+        return fds;
+    }
+
+    double map_lookup_ns(std::unordered_map<int, epoll_connection> &map, const std::vector<int> &fds)
+    {
+        std::size_t sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int fd : fds)
+        {
+            auto it = map.find(fd);
+            if (it != map.end())
+                sum += it->second.out_offset + 1;
+        }
+        double ns = seconds_since(start) * 1e9 / static_cast<double>(fds.size());
+        keep(sum);
+        return ns;
+    }
+
+    double table_lookup_ns(connection_table<epoll_connection> &table, const std::vector<int> &fds)
+    {
+        std::size_t sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int fd : fds)
+        {
+            if (epoll_connection *c = table.find(fd))
+                sum += c->out_offset + 1;
+        }
+        double ns = seconds_since(start) * 1e9 / static_cast<double>(fds.size());
+        keep(sum);
+        return ns;
+    }
+
+    double map_churn_ns(std::unordered_map<int, epoll_connection> &map, const std::vector<int> &fds)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int fd : fds)
+        {
+            keep(map[fd].want_close);
+            map.erase(fd);
+            map.emplace(fd, epoll_connection{});
+        }
+        return seconds_since(start) * 1e9 / static_cast<double>(fds.size());
+    }
+
+    double table_churn_ns(connection_table<epoll_connection> &table, const std::vector<int> &fds)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int fd : fds)
+        {
+            table.erase(fd);
+            keep(table.emplace(fd).want_close);
+        }
+        return seconds_since(start) * 1e9 / static_cast<double>(fds.size());
+    }
+
+    double table_pooled_churn_ns(connection_table<epoll_connection> &table, const std::vector<int> &fds)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int fd : fds)
+        {
+            table.retire(fd);
+            bool reused = false;
+            keep(table.revive(fd, reused).want_close);
+        }
+        return seconds_since(start) * 1e9 / static_cast<double>(fds.size());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t connections = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    std::size_t operations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+
+    std::unordered_map<int, epoll_connection> map;
+    connection_table<epoll_connection> table(FIRST_FD + connections);
+    for (std::size_t i = 0; i < connections; ++i)
+    {
+        int fd = FIRST_FD + static_cast<int>(i);
+        map.emplace(fd, epoll_connection{});
+        table.emplace(fd);
+    }
+
+    std::vector<int> lookups = random_fds(connections, operations);
+    std::vector<int> churn = random_fds(connections, operations / 10);
+
+    map_lookup_ns(map, lookups); // warm up
+    table_lookup_ns(table, lookups);
+
+    std::cout << connections << " connections, random fds, ns per operation\n";
+    std::cout << "lookup:      unordered_map " << map_lookup_ns(map, lookups)
+              << "   connection_table " << table_lookup_ns(table, lookups) << '\n';
+    std::cout << "close+open:  unordered_map " << map_churn_ns(map, churn)
+              << "   connection_table " << table_churn_ns(table, churn)
+              << "   pooled (retire+revive) " << table_pooled_churn_ns(table, churn) << '\n';
+    return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file group_scaling.cpp
+ * @brief Echo throughput of epoll_server_group with 1..N loops
+ *
+ * For every loop count the group serves an echo server on its own port.
+ * The same number of client threads each keep a set of connections busy:
+ * one 64-byte message in flight per connection, sent to all connections,
+ * then all replies read. Throughput is round trips per second over a
+ * fixed interval; speedup is relative to one loop.
+ *
+ * Clients run in the same process, so they compete with the loops for
+ * cores: give the machine at least twice as many cores as the largest loop
+ * count for the numbers to reflect the server alone.
+ *
+ * Build with -DBENCHMARKS=ON; run ./group_scaling_bench [max_loops] [seconds] [connections_per_client].
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../includes/epoll_server_group.hpp"
+
+using namespace hh_socket;
+
+namespace
+{
+    constexpr std::size_t MESSAGE_SIZE = 64;
+
+    class echo_server : public epoll_server
+    {
+    public:
+        echo_server() : epoll_server(4096) {}
+
+    protected:
+        void on_message_received(connection_handle h, const data_buffer &db) override { send_message(h, db); }
+
+        void on_connection_opened(std::shared_ptr<connection>) override {}
+        void on_connection_closed(std::shared_ptr<connection>) override {}
+        void on_listen_success() override {}
+        void on_shutdown_success() override {}
+    };
+
+    int connect_to(uint16_t port)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        while (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return fd;
+    }
+
+    bool read_exact(int fd, char *buf, std::size_t n)
+    {
+        std::size_t got = 0;
+        while (got < n)
+        {
+            ssize_t r = ::recv(fd, buf + got, n - got, 0);
+            if (r <= 0)
+                return false;
+            got += static_cast<std::size_t>(r);
+        }
+        return true;
+    }
+
+    /// Round trips per second with loops event loops
+    double run(std::size_t loops, uint16_t port, double seconds, std::size_t per_client)
+    {
+        epoll_server_group group(loops, []
+                                 { return std::make_unique<echo_server>(); });
+        group.register_listener(port, "127.0.0.1");
+        std::thread server([&]
+                           { group.listen(100); });
+
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> round_trips{0};
+        std::vector<std::vector<int>> fds(loops);
+        for (auto &set : fds)
+            for (std::size_t i = 0; i < per_client; ++i)
+                set.push_back(connect_to(port));
+
+        std::vector<std::thread> clients;
+        auto start = std::chrono::steady_clock::now();
+        for (auto &set : fds)
+        {
+            clients.emplace_back([&stop, &round_trips, &set]
+                                 {
+                char msg[MESSAGE_SIZE] = {};
+                char reply[MESSAGE_SIZE];
+                uint64_t done = 0;
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    for (int fd : set)
+                        ::send(fd, msg, sizeof(msg), 0);
+                    for (int fd : set)
+                        if (read_exact(fd, reply, sizeof(reply)))
+                            ++done;
+                }
+                round_trips.fetch_add(done); });
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+        for (auto &t : clients)
+            t.join();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (auto &set : fds)
+            for (int fd : set)
+                ::close(fd);
+        group.stop_server();
+        server.join();
+        return static_cast<double>(round_trips.load()) / elapsed;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t max_loops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::max<std::size_t>(1, hw / 2);
+    double seconds = argc > 2 ? std::strtod(argv[2], nullptr) : 2.0;
+    std::size_t per_client = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 16;
+
+    std::cout << "cores " << hw << ", " << per_client << " connections per client thread, "
+              << MESSAGE_SIZE << "-byte messages\n";
+    std::cout << "loops   round trips/s   speedup\n";
+    double base = 0;
+    for (std::size_t loops = 1; loops <= max_loops; ++loops)
+    {
+        double rate = run(loops, static_cast<uint16_t>(19500 + loops), seconds, per_client);
+        if (loops == 1)
+            base = rate;
+        std::cout << loops << "       " << static_cast<uint64_t>(rate) << "        " << rate / base << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,268 @@
+/**
+ * @file io_uring_echo.cpp
+ * @brief Syscalls per request and latency of epoll_server vs io_uring_server
+ *
+ * Both backends serve the same echo server. Client threads each drive one
+ * connection with one 64-byte request in flight and record every round
+ * trip. Reported per backend: requests per second, syscalls the loop
+ * thread made per request and per second, and p50/p99/max latency.
+ *
+ * Syscalls are counted by wrapping the libc entry points the loop uses
+ * (linker --wrap, see CMakeLists.txt); only calls made on the loop thread
+ * are counted, so the clients' own syscalls are excluded.
+ *
+ * Build with -DBENCHMARKS=ON -DIO_URING=ON; without IO_URING, or on a
+ * kernel without the required io_uring features, the second run reports
+ * the epoll fallback. Run ./io_uring_echo_bench [seconds] [clients].
+ */
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+#include "../includes/io_uring_server.hpp"
+#include "../includes/utilities.hpp"
+
+using namespace hh_socket;
+
+namespace
+{
+    /// Set on the loop thread only
+    thread_local bool counting = false;
+
+    std::atomic<uint64_t> loop_syscalls{0};
+
+    inline void count()
+    {
+        if (counting)
+            loop_syscalls.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Wrapped libc calls: counted, then forwarded to the real implementation
+extern "C"
+{
+    int __real_epoll_wait(int, epoll_event *, int, int);
+    int __real_epoll_ctl(int, int, int, epoll_event *);
+    ssize_t __real_recv(int, void *, size_t, int);
+    ssize_t __real_send(int, const void *, size_t, int);
+    ssize_t __real_sendmsg(int, const msghdr *, int);
+    ssize_t __real_read(int, void *, size_t);
+    ssize_t __real_write(int, const void *, size_t);
+    int __real_accept4(int, sockaddr *, socklen_t *, int);
+    int __real_close(int);
+    long __real_syscall(long, ...);
+
+    int __wrap_epoll_wait(int epfd, epoll_event *events, int maxevents, int timeout)
+    {
+        count();
+        return __real_epoll_wait(epfd, events, maxevents, timeout);
+    }
+
+    int __wrap_epoll_ctl(int epfd, int op, int fd, epoll_event *event)
+    {
+        count();
+        return __real_epoll_ctl(epfd, op, fd, event);
+    }
+
+    ssize_t __wrap_recv(int fd, void *buf, size_t len, int flags)
+    {
+        count();
+        return __real_recv(fd, buf, len, flags);
+    }
+
+    ssize_t __wrap_send(int fd, const void *buf, size_t len, int flags)
+    {
+        count();
+        return __real_send(fd, buf, len, flags);
+    }
+
+    ssize_t __wrap_sendmsg(int fd, const msghdr *msg, int flags)
+    {
+        count();
+        return __real_sendmsg(fd, msg, flags);
+    }
+
+    ssize_t __wrap_read(int fd, void *buf, size_t len)
+    {
+        count();
+        return __real_read(fd, buf, len);
+    }
+
+    ssize_t __wrap_write(int fd, const void *buf, size_t len)
+    {
+        count();
+        return __real_write(fd, buf, len);
+    }
+
+    int __wrap_accept4(int fd, sockaddr *addr, socklen_t *len, int flags)
+    {
+        count();
+        return __real_accept4(fd, addr, len, flags);
+    }
+
+    int __wrap_close(int fd)
+    {
+        count();
+        return __real_close(fd);
+    }
+
+    /// io_uring_setup/enter/register; every caller passes at most six word-sized arguments
+    long __wrap_syscall(long number, ...)
+    {
+        count();
+        va_list args;
+        va_start(args, number);
+        long a[6];
+        for (long &arg : a)
+            arg = va_arg(args, long);
+        va_end(args);
+        return __real_syscall(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+    }
+}
+
+namespace
+{
+    constexpr std::size_t MESSAGE_SIZE = 64;
+
+    template <class Base>
+    class echo_server : public Base
+    {
+    public:
+        echo_server() : Base(4096) {}
+
+    protected:
+        void on_message_received(connection_handle h, const data_buffer &db) override { this->send_message(h, db); }
+
+        void on_connection_opened(std::shared_ptr<connection>) override {}
+        void on_connection_closed(std::shared_ptr<connection>) override {}
+        void on_listen_success() override {}
+        void on_shutdown_success() override {}
+    };
+
+    int connect_to(uint16_t port)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        while (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return fd;
+    }
+
+    double percentile(const std::vector<double> &sorted, double p)
+    {
+        if (sorted.empty())
+            return 0;
+        std::size_t i = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1));
+        return sorted[i];
+    }
+
+    template <class Server>
+    void run(const std::string &name, uint16_t port, double seconds, std::size_t clients)
+    {
+        Server server;
+        server.register_listener_socket(make_listener_socket(port, "127.0.0.1", 128));
+        std::thread loop([&]
+                         {
+            counting = true;
+            server.listen(100); });
+
+        std::vector<int> fds;
+        for (std::size_t i = 0; i < clients; ++i)
+            fds.push_back(connect_to(port));
+
+        std::atomic<bool> stop{false};
+        std::mutex lock;
+        std::vector<double> latencies;
+        std::vector<std::thread> threads;
+        uint64_t before = loop_syscalls.load();
+        auto start = std::chrono::steady_clock::now();
+        for (int fd : fds)
+        {
+            threads.emplace_back([&, fd]
+                                 {
+                std::vector<double> mine;
+                mine.reserve(1 << 20);
+                char msg[MESSAGE_SIZE] = {};
+                char reply[MESSAGE_SIZE];
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    auto sent = std::chrono::steady_clock::now();
+                    ::send(fd, msg, sizeof(msg), 0);
+                    std::size_t got = 0;
+                    while (got < sizeof(reply))
+                    {
+                        ssize_t r = ::recv(fd, reply + got, sizeof(reply) - got, 0);
+                        if (r <= 0)
+                            return;
+                        got += static_cast<std::size_t>(r);
+                    }
+                    mine.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+                }
+                std::lock_guard<std::mutex> guard(lock);
+                latencies.insert(latencies.end(), mine.begin(), mine.end()); });
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+        for (auto &t : threads)
+            t.join();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t syscalls = loop_syscalls.load() - before;
+
+        bool ring = server.is_using_io_uring();
+        for (int fd : fds)
+            ::close(fd);
+        server.stop_server();
+        loop.join();
+
+        std::sort(latencies.begin(), latencies.end());
+        double requests = static_cast<double>(latencies.size());
+        std::cout << name << (ring ? " (io_uring)" : " (epoll)") << '\n'
+                  << "  requests/s       " << static_cast<uint64_t>(requests / elapsed) << '\n'
+                  << "  syscalls/request " << static_cast<double>(syscalls) / requests << '\n'
+                  << "  syscalls/s       " << static_cast<uint64_t>(static_cast<double>(syscalls) / elapsed) << '\n'
+                  << "  latency us       p50 " << percentile(latencies, 0.50)
+                  << "   p99 " << percentile(latencies, 0.99)
+                  << "   max " << (latencies.empty() ? 0 : latencies.back()) << '\n';
+    }
+
+    /// Runs the plain epoll loop: the io_uring class forced onto its fallback path is not the same code
+    class epoll_echo : public echo_server<epoll_server>
+    {
+    public:
+        bool is_using_io_uring() const { return false; }
+    };
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? std::strtod(argv[1], nullptr) : 3.0;
+    std::size_t clients = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 8;
+
+    std::cout << clients << " clients, one " << MESSAGE_SIZE << "-byte request in flight each\n";
+    run<epoll_echo>("epoll_server", 19601, seconds, clients);
+    run<echo_server<io_uring_server>>("io_uring_server", 19602, seconds, clients);
+    return 0;
+}
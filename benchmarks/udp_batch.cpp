@@ -0,0 +1,293 @@
+/**
+ * @file udp_batch.cpp
+ * @brief UDP datagram throughput: per-datagram calls vs recvmmsg/sendmmsg batches vs GSO/GRO
+ *
+ * Datagrams of 64 and 1400 bytes go over loopback in these modes:
+ * - single: socket::send_to() / socket::receive(), one syscall per datagram
+ * - batch:  socket::send_batch() / socket::receive_batch() with batches of 64
+ * - gso:    socket::send_segments() of 44 datagrams per call, received with
+ *           set_gro(true) and receive(socket_address &, std::size_t &);
+ *           1400 bytes only. Without UDP_SEGMENT/UDP_GRO both sides fall
+ *           back to one datagram per syscall.
+ *
+ * Each mode is measured three ways:
+ * 1. Loopback: a sender thread blasts a receiver thread for a fixed time.
+ *    Reported is the rate the receiver got and the share the kernel dropped
+ *    because the receiver fell behind; UDP has no flow control.
+ * 2. Send only: the receiving socket is never read, so the sender's rate
+ *    is not held back by the receiver.
+ * 3. Drain: the receive buffer is filled first, then emptied as fast as
+ *    possible, so the receiver's rate is not held back by the sender.
+ *
+ * On loopback the sender's syscall also runs the receive-side delivery, so
+ * (2) and (3) show the per-side saving more clearly than (1) does.
+ *
+ * Build with -DBENCHMARKS=ON; run ./udp_batch_bench [seconds].
+ */
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../includes/datagram_batch.hpp"
+#include "../includes/exceptions.hpp"
+#include "../includes/socket.hpp"
+
+using namespace hh_socket;
+
+namespace
+{
+    constexpr std::size_t BATCH = 64;
+
+    /// Datagrams per send_segments() call: 61600 bytes of 1400-byte segments
+    constexpr std::size_t SEGMENTS = 44;
+
+    /// Datagrams sent into the receive buffer before each drain
+    constexpr std::size_t FILL = 2048;
+
+    using clock = std::chrono::steady_clock;
+
+    /// Sends until stop is set, returns datagrams sent
+    using send_loop = std::function<uint64_t(hh_socket::socket &, const socket_address &, std::size_t, const std::atomic<bool> &)>;
+
+    /// Receives until the socket stays quiet for the receive timeout.
+    /// Counts datagrams received while counting is set; last is the time of the last one.
+    using receive_loop = std::function<uint64_t(hh_socket::socket &, const std::atomic<bool> &counting, clock::time_point &last)>;
+
+    uint64_t send_single(hh_socket::socket &s, const socket_address &to, std::size_t size, const std::atomic<bool> &stop)
+    {
+        data_buffer payload(std::string(size, 'x'));
+        uint64_t sent = 0;
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            s.send_to(to, payload);
+            ++sent;
+        }
+        return sent;
+    }
+
+    uint64_t send_batched(hh_socket::socket &s, const socket_address &to, std::size_t size, const std::atomic<bool> &stop)
+    {
+        datagram_batch batch(BATCH, size);
+        std::string payload(size, 'x');
+        while (batch.push(to, payload))
+        {
+        }
+        uint64_t sent = 0;
+        while (!stop.load(std::memory_order_relaxed))
+            sent += s.send_batch(batch);
+        return sent;
+    }
+
+    uint64_t send_segmented(hh_socket::socket &s, const socket_address &to, std::size_t size, const std::atomic<bool> &stop)
+    {
+        data_buffer payload(std::string(size * SEGMENTS, 'x'));
+        uint64_t sent = 0;
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            s.send_segments(to, payload, size);
+            sent += SEGMENTS;
+        }
+        return sent;
+    }
+
+    uint64_t receive_single(hh_socket::socket &s, const std::atomic<bool> &counting, clock::time_point &last)
+    {
+        socket_address from;
+        uint64_t received = 0;
+        try
+        {
+            while (true)
+            {
+                s.receive(from);
+                if (counting.load(std::memory_order_relaxed))
+                {
+                    ++received;
+                    last = clock::now();
+                }
+            }
+        }
+        catch (const socket_exception &)
+        {
+            // Receive timeout: the sender has stopped
+        }
+        return received;
+    }
+
+    uint64_t receive_batched(hh_socket::socket &s, const std::atomic<bool> &counting, clock::time_point &last)
+    {
+        datagram_batch batch(BATCH, 2048);
+        uint64_t received = 0;
+        try
+        {
+            while (true)
+            {
+                std::size_t n = s.receive_batch(batch);
+                if (n == 0)
+                    break;
+                if (counting.load(std::memory_order_relaxed))
+                {
+                    received += n;
+                    last = clock::now();
+                }
+            }
+        }
+        catch (const socket_exception &)
+        {
+        }
+        return received;
+    }
+
+    uint64_t receive_coalesced(hh_socket::socket &s, const std::atomic<bool> &counting, clock::time_point &last)
+    {
+        socket_address from;
+        uint64_t received = 0;
+        try
+        {
+            while (true)
+            {
+                std::size_t segment_size = 0;
+                data_buffer data = s.receive(from, segment_size);
+                if (counting.load(std::memory_order_relaxed) && segment_size)
+                {
+                    received += (data.size() + segment_size - 1) / segment_size;
+                    last = clock::now();
+                }
+            }
+        }
+        catch (const socket_exception &)
+        {
+        }
+        return received;
+    }
+
+    /// One way of sending and receiving
+    struct mode
+    {
+        const char *name;
+        send_loop sender;
+        receive_loop receiver;
+        bool gro;
+    };
+
+    hh_socket::socket make_receiver(const socket_address &addr, long quiet_us, bool gro)
+    {
+        hh_socket::socket rx(addr, Protocol::UDP);
+        rx.set_option(SOL_SOCKET, SO_RCVBUF, 4 << 20);
+        timeval quiet{0, quiet_us};
+        ::setsockopt(rx.get_fd(), SOL_SOCKET, SO_RCVTIMEO, &quiet, sizeof(quiet));
+        if (gro && !rx.set_gro(true))
+            std::cout << "  (UDP_GRO unavailable, receiving one datagram per call)\n";
+        return rx;
+    }
+
+    /// Sender and receiver threads at once; prints received rate and drops
+    void loopback(std::size_t size, uint16_t port_number, double seconds, const mode &m)
+    {
+        socket_address addr(port(port_number), ip_address("127.0.0.1"));
+        hh_socket::socket rx = make_receiver(addr, 200000, m.gro);
+        hh_socket::socket tx(Protocol::UDP);
+
+        std::atomic<bool> stop{false}, counting{true};
+        uint64_t received = 0, sent = 0;
+        clock::time_point last;
+        std::thread reader([&]
+                           { received = m.receiver(rx, counting, last); });
+        std::thread writer([&]
+                           { sent = m.sender(tx, addr, size, stop); });
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        counting = false;
+        stop = true;
+        writer.join();
+        reader.join();
+
+        double pps = static_cast<double>(received) / seconds;
+        double loss = sent ? 100.0 * (1.0 - static_cast<double>(received) / static_cast<double>(sent)) : 0;
+        std::cout << "  loopback   " << static_cast<uint64_t>(pps) << " pps   "
+                  << pps * static_cast<double>(size) * 8 / 1e9 << " Gbit/s   dropped " << (loss < 0 ? 0 : loss) << "%\n";
+    }
+
+    /// Sender alone, into a socket nobody reads
+    void send_only(std::size_t size, uint16_t port_number, double seconds, const mode &m)
+    {
+        socket_address addr(port(port_number), ip_address("127.0.0.1"));
+        hh_socket::socket rx = make_receiver(addr, 200000, m.gro);
+        hh_socket::socket tx(Protocol::UDP);
+
+        std::atomic<bool> stop{false};
+        uint64_t sent = 0;
+        auto start = clock::now();
+        std::thread writer([&]
+                           { sent = m.sender(tx, addr, size, stop); });
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+        writer.join();
+        double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        std::cout << "  send only  " << static_cast<uint64_t>(static_cast<double>(sent) / elapsed) << " pps\n";
+    }
+
+    /// Receiver alone: fill the buffer, then time how fast it empties, repeated for seconds.
+    /// GRO receivers are filled with send_segments(), the only way loopback hands them coalesced runs.
+    void drain(std::size_t size, uint16_t port_number, double seconds, const mode &m)
+    {
+        socket_address addr(port(port_number), ip_address("127.0.0.1"));
+        hh_socket::socket rx = make_receiver(addr, 20000, m.gro);
+        hh_socket::socket tx(Protocol::UDP);
+        data_buffer payload(std::string(size, 'x'));
+        data_buffer segments(std::string(size * SEGMENTS, 'x'));
+
+        std::atomic<bool> counting{true};
+        uint64_t received = 0;
+        double busy = 0;
+        auto end = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+        while (clock::now() < end)
+        {
+            if (m.gro)
+            {
+                for (std::size_t i = 0; i < FILL / SEGMENTS; ++i)
+                    tx.send_segments(addr, segments, size);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < FILL; ++i)
+                    tx.send_to(addr, payload);
+            }
+            auto start = clock::now();
+            clock::time_point last = start;
+            received += m.receiver(rx, counting, last);
+            busy += std::chrono::duration<double>(last - start).count();
+        }
+        std::cout << "  drain      " << static_cast<uint64_t>(static_cast<double>(received) / busy) << " pps\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? std::strtod(argv[1], nullptr) : 2.0;
+
+    const mode single{"single", send_single, receive_single, false};
+    const mode batch{"batch ", send_batched, receive_batched, false};
+    const mode gso{"gso   ", send_segmented, receive_coalesced, true};
+
+    uint16_t port_number = 19700;
+    for (std::size_t size : {std::size_t(64), std::size_t(1400)})
+    {
+        for (const mode *m : {&single, &batch, &gso})
+        {
+            if (m == &gso && size != 1400)
+                continue;
+            std::cout << m->name << " " << size << "B\n";
+            loopback(size, port_number++, seconds, *m);
+            send_only(size, port_number++, seconds, *m);
+            drain(size, port_number++, seconds, *m);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+/**
+ * @file buffer_pool.hpp
+ * @brief Pool of fixed-size receive blocks shared with data_buffer slices
+ *
+ * Received data is handed to the application as data_buffer slices of a
+ * block. Instead of allocating a fresh block whenever the current one fills
+ * up, the event loop takes one from a buffer_pool. A block becomes reusable
+ * as soon as every slice of it has been released; slices the application
+ * keeps simply keep their block out of circulation.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data_buffer.hpp"
+#include "utilities.hpp"
+
+namespace hh_socket
+{
+    /**
+     * @brief Recycles fixed-size byte blocks without ever freeing them in steady state
+     *
+     * The pool keeps a shared_ptr to every block it created. A block whose
+     * only owner is the pool (use_count() == 1) is free, so lending and
+     * returning a block is pure reference counting: no free list to update,
+     * no custom deleter and no allocation for the shared_ptr control block.
+     *
+     * Threading:
+     * - acquire() must be called from a single thread (the owning loop).
+     * - Slices of a block may be released on any thread.
+     * - hits()/misses() may be read from any thread.
+     */
+    class buffer_pool
+    {
+    private:
+        /// Every pooled block, free or lent out
+        std::vector<std::shared_ptr<std::string>> blocks;
+
+        /// Size of each block in bytes
+        std::size_t block_bytes;
+
+        /// Maximum number of blocks kept by the pool
+        std::size_t max_blocks;
+
+        /// Round-robin scan position in blocks
+        std::size_t next = 0;
+
+        /// acquire() calls served by a recycled block
+        std::atomic<uint64_t> hit_count{0};
+
+        /// acquire() calls that had to allocate
+        std::atomic<uint64_t> miss_count{0};
+
+    public:
+        /**
+         * @brief Creates an empty pool; blocks are allocated on demand
+         * @param block_size Size of each block in bytes (default: MAX_BUFFER_SIZE)
+         * @param max_blocks Maximum number of blocks retained (default: 64)
+         *
+         * When every retained block is lent out, acquire() still succeeds
+         * with an unpooled block that is freed normally once released.
+         */
+        explicit buffer_pool(std::size_t block_size = MAX_BUFFER_SIZE, std::size_t max_blocks = 64);
+
+        // The pool owns its blocks and is referenced by the loop that uses it
+        buffer_pool(const buffer_pool &) = delete;
+        buffer_pool &operator=(const buffer_pool &) = delete;
+
+        /**
+         * @brief Lends a block of block_size() bytes
+         * @return Block that no one else references; contents are unspecified
+         */
+        std::shared_ptr<std::string> acquire();
+
+        /**
+         * @brief Hands out the first bytes of a block filled by a single receive
+         * @param block Block from acquire()
+         * @param size Bytes received into it
+         * @return Slice of block, or an exact-size copy when size is below a quarter of block_size()
+         *
+         * A slice the caller keeps pins the whole block. Small results are
+         * copied instead, so a retained short message holds only its own
+         * bytes and the block goes straight back into the pool.
+         */
+        data_buffer take(std::shared_ptr<std::string> block, std::size_t size) const;
+
+        /**
+         * @brief Get the size of each block
+         * @return Block size in bytes
+         */
+        std::size_t block_size() const { return block_bytes; }
+
+        /**
+         * @brief Get the number of blocks currently retained by the pool
+         * @return Number of pooled blocks (free and lent out)
+         */
+        std::size_t size() const { return blocks.size(); }
+
+        /**
+         * @brief Get the number of acquire() calls served without allocating
+         * @return Hit counter
+         */
+        uint64_t hits() const { return hit_count.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Get the number of acquire() calls that allocated a new block
+         * @return Miss counter
+         */
+        uint64_t misses() const { return miss_count.load(std::memory_order_relaxed); }
+    };
+
+    /**
+     * @brief The calling thread's pool for blocking receives
+     * @return Pool of MAX_BUFFER_SIZE blocks, at most 8 retained per thread
+     *
+     * Shared by connection::receive() and both socket::receive() overloads,
+     * so a thread using several of them keeps one set of blocks and every
+     * path reuses the blocks the others released.
+     */
+    buffer_pool &thread_receive_pool();
+}
@@ -91,7 +91,8 @@ namespace hh_socket
 
         /**
          * @brief Receive data from established connection
-         * @return Buffer containing received data
+         * @return Buffer containing received data; a slice of a pooled 64KB block if
+         *         at least 16KB arrived (keeping it pins the block), else an exact-size copy
          * @throws socket_exception with type "ProtocolMismatch" if called on non-TCP socket
          * @throws socket_exception with type "SocketRead" if read operation fails
          */
@@ -0,0 +1,61 @@
+#pragma once
+
+/**
+ * @file connection_handle.hpp
+ * @brief Trivially copyable reference to a connection of an event loop
+ *
+ * Passing std::shared_ptr<connection> by value costs an atomic increment and
+ * decrement per call. A connection_handle names the connection by its slot
+ * in the loop's connection table (the fd) plus the slot's generation, and
+ * is copied like an integer. A handle outlives its connection safely: once
+ * the connection closed, the generation no longer matches and every
+ * operation through the handle is a no-op.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+namespace hh_socket
+{
+    /**
+     * @brief Slot index and generation of a connection in an epoll_server
+     *
+     * Obtained from the handle callbacks (on_message_received(connection_handle, ...))
+     * or epoll_server::get_handle(), and resolved by the same loop with
+     * send_message(), close_connection(), get_connection() or
+     * share_connection().
+     *
+     * @note Only meaningful on the loop that issued it.
+     */
+    struct connection_handle
+    {
+        /// Slot index: the connection's file descriptor, -1 for no connection
+        int fd = -1;
+
+        /// Generation of the slot when the connection was opened
+        uint32_t generation = 0;
+
+        /// True if the handle refers to a connection (which may have closed since)
+        bool valid() const { return fd >= 0; }
+
+        bool operator==(const connection_handle &other) const { return fd == other.fd && generation == other.generation; }
+        bool operator!=(const connection_handle &other) const { return !(*this == other); }
+    };
+
+    static_assert(std::is_trivially_copyable<connection_handle>::value,
+                  "connection_handle must stay a plain value");
+}
+
+namespace std
+{
+    template <>
+    struct hash<hh_socket::connection_handle>
+    {
+        std::size_t operator()(const hh_socket::connection_handle &h) const noexcept
+        {
+            return std::hash<uint64_t>()((static_cast<uint64_t>(h.generation) << 32) | static_cast<uint32_t>(h.fd));
+        }
+    };
+}
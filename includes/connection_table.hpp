@@ -0,0 +1,331 @@
+#pragma once
+
+/**
+ * @file connection_table.hpp
+ * @brief Flat, fd-indexed table of per-connection state
+ *
+ * File descriptors are small dense integers bounded by the server's fd limit,
+ * so per-connection state is stored in an array indexed by fd instead of a
+ * hash map. A lookup is a shift, a mask and two loads; there is no hashing,
+ * no probing and no node allocation per connection.
+ *
+ * Storage:
+ * - Slots live in fixed pages of PAGE_SIZE entries. The page directory is
+ *   sized for the fd limit up front, pages are allocated on first use and
+ *   kept, so a slot never moves once created and references stay valid
+ *   across inserts.
+ * - Each slot is aligned to a cache line, so the state of two connections
+ *   never shares a line.
+ * - Each slot carries a generation that is bumped on every insert, letting
+ *   callers detect that an fd number was closed and reused.
+ * - A closed connection's state can be retired instead of erased: it stays
+ *   constructed in its slot, hidden from lookups, and the next connection
+ *   that gets the fd reuses it (and whatever storage it holds). The kernel
+ *   hands out the lowest free fd, so the slots of recently closed fds are
+ *   the pool's free list.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace hh_socket
+{
+    /**
+     * @brief Array of T indexed by file descriptor, with a per-slot generation
+     *
+     * @tparam T Per-connection state
+     *
+     * @note Not thread-safe; owned by a single event loop.
+     */
+    template <typename T>
+    class connection_table
+    {
+    private:
+        static const unsigned PAGE_BITS = 8;
+        static const std::size_t PAGE_SIZE = std::size_t(1) << PAGE_BITS;
+        static const std::size_t PAGE_MASK = PAGE_SIZE - 1;
+
+        /// One connection, padded to a cache line; the generation comes first
+        struct alignas(64) slot
+        {
+            uint32_t generation = 0;
+            /// True while the slot belongs to an open connection; value may outlive it when retired
+            bool live = false;
+            std::optional<T> value;
+        };
+
+        /// Page directory, indexed by fd >> PAGE_BITS; null until a slot of the page is used
+        std::vector<std::unique_ptr<slot[]>> pages;
+
+        /// Number of used slots
+        std::size_t count = 0;
+
+        /// Number of retired slots still holding a constructed value
+        std::size_t dormant = 0;
+
+        /// Get fd's slot, allocating its page if needed
+        slot &make_slot(int fd)
+        {
+            std::size_t page = static_cast<std::size_t>(fd) >> PAGE_BITS;
+            if (page >= pages.size())
+                pages.resize(page + 1);
+            if (!pages[page])
+                pages[page].reset(new slot[PAGE_SIZE]);
+            return pages[page][static_cast<std::size_t>(fd) & PAGE_MASK];
+        }
+
+        /// Get the slot of fd, or nullptr if its page was never allocated
+        slot *slot_of(int fd) const
+        {
+            std::size_t page = static_cast<std::size_t>(static_cast<unsigned>(fd)) >> PAGE_BITS;
+            if (page >= pages.size() || !pages[page])
+                return nullptr;
+            return &pages[page][static_cast<std::size_t>(fd) & PAGE_MASK];
+        }
+
+    public:
+        /**
+         * @brief Iterator over the used slots, yielding (fd, state) pairs
+         *
+         * Dereferencing returns a std::pair<int, T &> by value, so use
+         * `for (auto &&[fd, c] : table)` or `const auto &[fd, c]`.
+         */
+        class iterator
+        {
+        private:
+            const connection_table *table = nullptr;
+            std::size_t fd = 0;
+
+            void skip_unused()
+            {
+                std::size_t end = table->pages.size() << PAGE_BITS;
+                while (fd < end)
+                {
+                    const auto &page = table->pages[fd >> PAGE_BITS];
+                    if (!page)
+                        fd = (fd | PAGE_MASK) + 1;
+                    else if (!page[fd & PAGE_MASK].live)
+                        ++fd;
+                    else
+                        break;
+                }
+            }
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<int, T &>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            iterator() = default;
+            iterator(const connection_table *table, std::size_t fd) : table(table), fd(fd) { skip_unused(); }
+
+            value_type operator*() const
+            {
+                return {static_cast<int>(fd), *table->pages[fd >> PAGE_BITS][fd & PAGE_MASK].value};
+            }
+
+            iterator &operator++()
+            {
+                ++fd;
+                skip_unused();
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                iterator tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            bool operator==(const iterator &other) const { return fd == other.fd; }
+            bool operator!=(const iterator &other) const { return fd != other.fd; }
+        };
+
+        /**
+         * @brief Creates a table sized for fds in [0, capacity)
+         * @param capacity Expected fd limit; only the page directory is allocated
+         *
+         * Larger fds are still accepted, the directory grows on demand.
+         */
+        explicit connection_table(std::size_t capacity = 1024)
+            : pages((capacity + PAGE_MASK) >> PAGE_BITS) {}
+
+        /**
+         * @brief Sizes the page directory for fds in [0, capacity)
+         * @param capacity Expected fd limit
+         */
+        void reserve(std::size_t capacity)
+        {
+            std::size_t needed = (capacity + PAGE_MASK) >> PAGE_BITS;
+            if (needed > pages.size())
+                pages.resize(needed);
+        }
+
+        connection_table(const connection_table &) = delete;
+        connection_table &operator=(const connection_table &) = delete;
+
+        /**
+         * @brief Finds the state of a connection
+         * @param fd File descriptor
+         * @return Pointer to the state, or nullptr if fd has no entry
+         */
+        T *find(int fd)
+        {
+            slot *s = slot_of(fd);
+            return s && s->live ? &*s->value : nullptr;
+        }
+
+        /// @copydoc find(int)
+        const T *find(int fd) const
+        {
+            const slot *s = slot_of(fd);
+            return s && s->live ? &*s->value : nullptr;
+        }
+
+        /**
+         * @brief Finds the state of a connection only if it is the expected one
+         * @param fd File descriptor
+         * @param generation Generation recorded when the handle was created
+         * @return Pointer to the state, or nullptr if fd has no entry or was reused since
+         */
+        T *find(int fd, uint32_t generation)
+        {
+            slot *s = slot_of(fd);
+            return s && s->live && s->generation == generation ? &*s->value : nullptr;
+        }
+
+        /**
+         * @brief Check whether fd has an entry
+         * @param fd File descriptor
+         * @return true if the slot is in use
+         */
+        bool contains(int fd) const { return find(fd) != nullptr; }
+
+        /**
+         * @brief Constructs the state of a newly opened connection in its slot
+         * @param fd File descriptor, must be >= 0
+         * @param args Arguments forwarded to T's constructor
+         * @return Reference to the stored state, valid until erase(fd)
+         *
+         * Replaces a stale or retired entry, if any, and bumps the slot's generation.
+         */
+        template <typename... Args>
+        T &emplace(int fd, Args &&...args)
+        {
+            slot &s = make_slot(fd);
+            if (s.value && !s.live)
+                --dormant;
+            if (!s.live)
+                ++count;
+            s.live = true;
+            ++s.generation;
+            return s.value.emplace(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Brings fd's slot into use, reusing retired state if the slot holds one
+         * @param fd File descriptor, must be >= 0
+         * @param reused Set to true if a retired value was handed back, false if a new one was default-constructed
+         * @return Reference to the stored state, valid until erase(fd) or retire(fd)
+         *
+         * Bumps the slot's generation like emplace(). A reused value is
+         * returned exactly as retire() left it; the caller reinitialises it.
+         */
+        T &revive(int fd, bool &reused)
+        {
+            slot &s = make_slot(fd);
+            reused = s.value && !s.live;
+            if (reused)
+                --dormant;
+            else
+                s.value.emplace(); // Fresh, or replacing a stale entry
+            if (!s.live)
+                ++count;
+            s.live = true;
+            ++s.generation;
+            return *s.value;
+        }
+
+        /**
+         * @brief Removes the state of a connection
+         * @param fd File descriptor
+         * @return true if an entry was removed
+         *
+         * Destroys the state in place; the slot memory stays allocated for
+         * the next connection that gets this fd.
+         */
+        bool erase(int fd)
+        {
+            slot *s = slot_of(fd);
+            if (!s || !s->live)
+                return false;
+            s->value.reset();
+            s->live = false;
+            --count;
+            return true;
+        }
+
+        /**
+         * @brief Removes a connection but keeps its state constructed for reuse
+         * @param fd File descriptor
+         * @return true if an entry was retired
+         *
+         * The slot drops out of find(), iteration and size(); revive(fd)
+         * hands the value back to the next connection with this fd. Retired
+         * values are destroyed with the table.
+         */
+        bool retire(int fd)
+        {
+            slot *s = slot_of(fd);
+            if (!s || !s->live)
+                return false;
+            s->live = false;
+            --count;
+            ++dormant;
+            return true;
+        }
+
+        /**
+         * @brief Get the generation of an fd's slot
+         * @param fd File descriptor
+         * @return Number of times the slot has been filled (0 if never)
+         */
+        uint32_t generation(int fd) const
+        {
+            const slot *s = slot_of(fd);
+            return s ? s->generation : 0;
+        }
+
+        /**
+         * @brief Get the number of stored connections
+         * @return Used slot count
+         */
+        std::size_t size() const { return count; }
+
+        /**
+         * @brief Check whether the table is empty
+         * @return true if no slot is used
+         */
+        bool empty() const { return count == 0; }
+
+        /**
+         * @brief Get the number of retired values kept for reuse
+         * @return Slots holding state that no open connection uses
+         */
+        std::size_t retired() const { return dormant; }
+
+        /// Iterator to the lowest used fd
+        iterator begin() const { return iterator(this, 0); }
+
+        /// Past-the-end iterator
+        iterator end() const { return iterator(this, pages.size() << PAGE_BITS); }
+    };
+}
@@ -1,36 +1,63 @@
 #pragma once
 
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
 #include <string>
-#include <vector>
+#include <string_view>
 #include "utilities.hpp"
 
 namespace hh_socket
 {
     /**
-     * @brief A dynamic buffer for storing and managing binary data.
+     * @brief A refcounted, immutable slice of binary data.
      *
-     * This class provides a convenient wrapper around std::vector<char> for handling
-     * binary data, strings, and character arrays. It offers efficient memory management
-     * with automatic resizing and supports both string and raw data operations.
+     * A data_buffer is a view (offset + length) into a shared, heap-allocated
+     * byte block. Copying a data_buffer or taking a slice() only bumps a
+     * reference count, so the same bytes can travel from the receive path
+     * through on_message_received() into the send queue without ever being
+     * copied in user space.
      *
-     * The class is designed for scenarios where you need to accumulate data from
-     * multiple sources (like network I/O, file reading, or HTTP parsing) and provides
-     * seamless conversion between different data representations.
+     * The bytes seen through a data_buffer never change once it has been
+     * created. append() is copy-on-write: it writes in place only when this
+     * buffer is the sole owner of its block and ends at the block's end,
+     * otherwise it first copies the visible bytes into a new block.
      *
+     * @note A slice keeps its whole block alive. Call compact() on a small
+     *       slice that must be retained for a long time to release the rest.
      * @note Uses explicit constructors to prevent implicit conversions for type safety.
      */
     class data_buffer
     {
     private:
-        /// Internal storage for the buffer data
-        std::vector<char> buffer;
+        /// Shared storage, null for an empty buffer
+        std::shared_ptr<std::string> block;
+
+        /// Start of this slice within the block
+        std::size_t offset = 0;
+
+        /// Number of bytes visible through this slice
+        std::size_t length = 0;
+
+        /// Makes this buffer the sole owner of a block ending at its slice end
+        void make_unique_tail(std::size_t extra)
+        {
+            if (block && block.use_count() == 1 && offset + length == block->size())
+                return;
+            auto fresh = std::make_shared<std::string>();
+            fresh->reserve(length + extra);
+            if (length)
+                fresh->append(block->data() + offset, length);
+            block = std::move(fresh);
+            offset = 0;
+        }
 
     public:
         /**
          * @brief Default constructor - creates an empty buffer.
          *
-         * Creates a data_buffer with no initial data. The buffer will be empty
-         * and ready to accept data through append operations.
+         * Creates a data_buffer with no initial data. No memory is allocated
+         * until data is appended.
          * Marked explicit to prevent implicit conversions.
          */
         explicit data_buffer() = default;
@@ -40,9 +67,20 @@ namespace hh_socket
          * @param str String to initialize the buffer with
          *
          * Creates a data_buffer containing a copy of the string's characters.
-         * The resulting buffer will have the same content as the string.
          */
-        explicit data_buffer(const std::string &str) : buffer(str.begin(), str.end()) {}
+        explicit data_buffer(const std::string &str)
+            : block(str.empty() ? nullptr : std::make_shared<std::string>(str)), length(str.size()) {}
+
+        /**
+         * @brief Construct buffer by taking ownership of a string.
+         * @param str String whose storage becomes the buffer's block
+         *
+         * No bytes are copied; use this to hand a response built as a
+         * std::string to send_message().
+         */
+        explicit data_buffer(std::string &&str)
+            : block(str.empty() ? nullptr : std::make_shared<std::string>(std::move(str))),
+              length(block ? block->size() : 0) {}
 
         /**
          * @brief Construct buffer from raw character data.
@@ -61,15 +99,27 @@ namespace hh_socket
          * data_buffer buf(raw_data, 7);  // Includes the null byte
          * @endcode
          */
-        explicit data_buffer(const char *data, std::size_t size) : buffer(data, data + size) {}
+        explicit data_buffer(const char *data, std::size_t size)
+            : block(size ? std::make_shared<std::string>(data, size) : nullptr), length(size) {}
+
+        /**
+         * @brief Construct a slice of an existing shared block.
+         * @param block Shared storage
+         * @param offset Start of the slice within block
+         * @param size Number of bytes in the slice
+         *
+         * Used by the receive path to hand out the bytes it read without
+         * copying them. The caller guarantees offset + size <= block->size().
+         */
+        explicit data_buffer(std::shared_ptr<std::string> block, std::size_t offset, std::size_t size)
+            : block(size ? std::move(block) : nullptr), offset(size ? offset : 0), length(size) {}
 
         // Copy operations
         /**
          * @brief Copy constructor.
          * @param other Buffer to copy from
          *
-         * Creates a deep copy of another data_buffer. The new buffer will contain
-         * a complete copy of the source buffer's data.
+         * O(1): the new buffer shares the other buffer's block.
          */
         data_buffer(const data_buffer &other) = default;
 
@@ -78,7 +128,7 @@ namespace hh_socket
          * @param other Buffer to copy from
          * @return Reference to this buffer after assignment
          *
-         * Replaces this buffer's content with a copy of the other buffer's data.
+         * O(1): this buffer shares the other buffer's block afterwards.
          */
         data_buffer &operator=(const data_buffer &other) = default;
 
@@ -87,45 +137,59 @@ namespace hh_socket
          * @brief Move constructor.
          * @param other Buffer to move from
          *
-         * Efficiently transfers ownership of the buffer data from another data_buffer.
-         * The source buffer becomes empty after the move. This operation is O(1)
-         * and doesn't copy the actual data.
+         * Transfers the block reference. The source buffer becomes empty.
          */
-        data_buffer(data_buffer &&other) = default;
+        data_buffer(data_buffer &&other) noexcept
+            : block(std::move(other.block)), offset(other.offset), length(other.length)
+        {
+            other.offset = other.length = 0;
+        }
 
         /**
          * @brief Move assignment operator.
          * @param other Buffer to move from
          * @return Reference to this buffer after assignment
          */
-        data_buffer &operator=(data_buffer &&other) = default;
+        data_buffer &operator=(data_buffer &&other) noexcept
+        {
+            if (this != &other)
+            {
+                block = std::move(other.block);
+                offset = other.offset;
+                length = other.length;
+                other.offset = other.length = 0;
+            }
+            return *this;
+        }
 
         /**
          * @brief Append raw character data to the buffer.
          * @param data Pointer to the character data to append
          * @param size Number of bytes to append from data
          *
-         * Adds the specified number of bytes from the character array to the end
-         * of the buffer. The buffer will automatically resize to accommodate the
-         * new data.
+         * Copy-on-write: other buffers sharing the block keep seeing their
+         * original bytes.
          *
          * @warning The caller must ensure that 'data' points to at least 'size' bytes
          */
         void append(const char *data, std::size_t size)
         {
-            buffer.insert(buffer.end(), data, data + size);
+            if (size == 0)
+                return;
+            make_unique_tail(size);
+            block->append(data, size);
+            length += size;
         }
 
         /**
          * @brief Append a string to the buffer.
          * @param str String to append
          *
-         * Adds all characters from the string to the end of the buffer.
          * This is equivalent to calling append(str.data(), str.size()).
          */
         void append(const std::string &str)
         {
-            buffer.insert(buffer.end(), str.begin(), str.end());
+            append(str.data(), str.size());
         }
 
         /**
@@ -136,54 +200,100 @@ namespace hh_socket
          */
         void append(const data_buffer &other)
         {
-            buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+            if (other.length == 0)
+                return;
+            if (length == 0)
+            {
+                *this = other;
+                return;
+            }
+            make_unique_tail(other.length);
+            // other may share our block, re-read its pointer after reallocation
+            block->append(other.block->data() + other.offset, other.length);
+            length += other.length;
+        }
+
+        /**
+         * @brief Get a sub-range of the buffer without copying.
+         * @param pos Offset of the first byte, relative to this buffer
+         * @param len Number of bytes (clamped to the end of the buffer)
+         * @return data_buffer sharing this buffer's block
+         * @throws std::out_of_range if pos > size()
+         *
+         * Example:
+         * @code
+         * data_buffer header = msg.slice(0, 4);
+         * data_buffer body = msg.slice(4);
+         * @endcode
+         */
+        data_buffer slice(std::size_t pos, std::size_t len = std::string::npos) const
+        {
+            if (pos > length)
+                throw std::out_of_range("data_buffer::slice position out of range");
+            len = std::min(len, length - pos);
+            return data_buffer(block, offset + pos, len);
+        }
+
+        /**
+         * @brief Copies the visible bytes into a right-sized block of their own.
+         *
+         * Releases the reference to a (possibly much larger) shared block.
+         * Useful before storing a small slice for a long time.
+         */
+        void compact()
+        {
+            if (block && (block.use_count() > 1 || block->size() != length))
+                *this = data_buffer(data(), length);
         }
 
         /**
          * @brief Get a pointer to the buffer's data.
          * @return Const pointer to the first byte of the buffer
          *
-         * Returns a pointer to the internal character array. The pointer is valid
-         * until the next non-const operation on the buffer. For empty buffers,
-         * the returned pointer may or may not be null, but should not be dereferenced.
+         * The pointer stays valid as long as any data_buffer shares the block
+         * and this buffer is not appended to. Returns nullptr for empty buffers.
          */
         const char *data() const
         {
-            return buffer.data();
+            return block ? block->data() + offset : nullptr;
         }
 
         /**
          * @brief Get the size of the buffer in bytes.
          * @return Number of bytes currently stored in the buffer
-         *
-         * Returns the total number of bytes contained in the buffer.
-         * For empty buffers, this returns 0.
          */
         std::size_t size() const
         {
-            return buffer.size();
+            return length;
         }
 
         /**
          * @brief Check if the buffer is empty.
          * @return true if the buffer contains no data, false otherwise
-         *
-         * This is equivalent to checking if size() == 0, but may be more efficient.
          */
         bool empty() const
         {
-            return buffer.empty();
+            return length == 0;
         }
 
         /**
          * @brief Clear all data from the buffer.
          *
-         * Removes all data from the buffer, making it empty. size() will return 0 after this call.
+         * Drops this buffer's reference to its block. size() will return 0 after this call.
          */
         void clear()
         {
-            buffer.clear();
-            buffer.shrink_to_fit();
+            block.reset();
+            offset = length = 0;
+        }
+
+        /**
+         * @brief View the buffer contents without copying.
+         * @return string_view over the buffer's bytes, valid while the block is alive
+         */
+        std::string_view view() const
+        {
+            return std::string_view(data(), length);
         }
 
         /**
@@ -191,17 +301,16 @@ namespace hh_socket
          * @return String containing a copy of the buffer's data
          *
          * Creates a new std::string containing all the bytes from the buffer.
-         * This operation creates a copy of the data, so the original buffer
-         * remains unchanged.
+         * Prefer view() when a copy is not needed.
          *
          * @note If the buffer contains null bytes, they will be included in the string
          */
         std::string to_string() const
         {
-            return std::string(buffer.begin(), buffer.end());
+            return std::string(data() ? data() : "", length);
         }
 
         /// Default destructor
         ~data_buffer() = default;
     };
-}
\ No newline at end of file
+}
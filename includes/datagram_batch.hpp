@@ -0,0 +1,229 @@
+#pragma once
+
+/**
+ * @file datagram_batch.hpp
+ * @brief Preallocated datagram slots for batched UDP receive and send
+ *
+ * socket::receive() and socket::send_to() move one datagram per syscall and
+ * build a data_buffer and a socket_address for each. A datagram_batch owns
+ * N fixed-size payload slots, N raw address slots and the kernel message
+ * headers describing them, all allocated once. socket::receive_batch() and
+ * socket::send_batch() then move up to N datagrams per syscall
+ * (recvmmsg/sendmmsg on Linux) without any per-packet allocation.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Platform-specific includes
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#include "socket_address.hpp"
+
+namespace hh_socket
+{
+    class socket;
+
+    /**
+     * @brief Fixed set of datagram slots reused across batched receives and sends
+     *
+     * Receiving: socket::receive_batch() fills slots [0, size()); read each
+     * one with data()/length() and its sender with address().
+     *
+     * Sending: clear(), push() up to capacity() datagrams, then
+     * socket::send_batch().
+     *
+     * Slot memory is one contiguous allocation of capacity() *
+     * datagram_size() bytes. Payloads longer than datagram_size() are
+     * truncated on receive (see truncated()) and rejected by push().
+     *
+     * @note Not thread-safe; use one batch per thread.
+     */
+    class datagram_batch
+    {
+    private:
+        /// Bytes per payload slot
+        std::size_t slot_bytes;
+
+        /// Number of filled slots
+        std::size_t count = 0;
+
+        /// Payload slots, slot i starts at i * slot_bytes
+        std::vector<char> storage;
+
+        /// Peer address of each slot: sender on receive, destination on send
+        std::vector<sockaddr_storage> addrs;
+
+#if defined(__linux__) || defined(__linux)
+        /// One recvmmsg/sendmmsg header per slot, pointing at its iovec and address
+        std::vector<mmsghdr> headers;
+
+        /// One iovec per slot, pointing at its payload
+        std::vector<iovec> iovs;
+#else
+        /// Payload length of each slot
+        std::vector<std::size_t> lengths;
+
+        /// Address length of each slot
+        std::vector<socklen_t> addr_lens;
+
+        /// Set for slots whose datagram was cut to datagram_size()
+        std::vector<uint8_t> truncs;
+#endif
+
+        /**
+         * @brief Resets every slot to a full-size payload and address, ready for receiving
+         */
+        void prepare_receive();
+
+        friend class socket;
+
+    public:
+        /**
+         * @brief Allocates all slots up front
+         * @param capacity Maximum datagrams per batch (default: 64)
+         * @param datagram_size Bytes per slot (default: 2048, enough for an Ethernet MTU)
+         * @throws std::invalid_argument if capacity or datagram_size is 0
+         */
+        explicit datagram_batch(std::size_t capacity = 64, std::size_t datagram_size = 2048);
+
+        datagram_batch(const datagram_batch &) = delete;
+        datagram_batch &operator=(const datagram_batch &) = delete;
+
+        /**
+         * @brief Get the number of slots
+         * @return Maximum datagrams per batch
+         */
+        std::size_t capacity() const { return addrs.size(); }
+
+        /**
+         * @brief Get the size of each payload slot
+         * @return Bytes per slot
+         */
+        std::size_t datagram_size() const { return slot_bytes; }
+
+        /**
+         * @brief Get the number of filled slots
+         * @return Datagrams received by the last receive_batch(), or pushed since clear()
+         */
+        std::size_t size() const { return count; }
+
+        /// Check whether no slot is filled
+        bool empty() const { return count == 0; }
+
+        /// Check whether every slot is filled
+        bool full() const { return count == addrs.size(); }
+
+        /// Empties the batch; slot memory is kept
+        void clear() { count = 0; }
+
+        /**
+         * @brief Get the payload of a slot
+         * @param i Slot index, < size()
+         * @return Pointer to the first byte, valid until the next receive or push into the slot
+         */
+        const char *data(std::size_t i) const { return storage.data() + i * slot_bytes; }
+
+        /// @copydoc data(std::size_t) const
+        char *data(std::size_t i) { return storage.data() + i * slot_bytes; }
+
+        /**
+         * @brief Get the payload length of a slot
+         * @param i Slot index, < size()
+         * @return Bytes in the datagram (at most datagram_size())
+         */
+        std::size_t length(std::size_t i) const
+        {
+#if defined(__linux__) || defined(__linux)
+            return headers[i].msg_len;
+#else
+            return lengths[i];
+#endif
+        }
+
+        /**
+         * @brief Get the payload of a slot as a view
+         * @param i Slot index, < size()
+         * @return View of the datagram, valid until the next receive or push into the slot
+         */
+        std::string_view view(std::size_t i) const { return std::string_view(data(i), length(i)); }
+
+        /**
+         * @brief Check whether a received datagram was longer than its slot
+         * @param i Slot index, < size()
+         * @return true if bytes past datagram_size() were discarded
+         */
+        bool truncated(std::size_t i) const
+        {
+#if defined(__linux__) || defined(__linux)
+            return headers[i].msg_hdr.msg_flags & MSG_TRUNC;
+#else
+            return truncs[i] != 0;
+#endif
+        }
+
+        /**
+         * @brief Get the raw peer address of a slot
+         * @param i Slot index, < size()
+         * @return Sender (after receive) or destination (after push)
+         *
+         * Can be passed straight to push() to reply without building a
+         * socket_address.
+         */
+        const sockaddr *address(std::size_t i) const { return reinterpret_cast<const sockaddr *>(&addrs[i]); }
+
+        /**
+         * @brief Get the length of the raw peer address of a slot
+         * @param i Slot index, < size()
+         * @return Size in bytes of the address returned by address(i)
+         */
+        socklen_t address_length(std::size_t i) const
+        {
+#if defined(__linux__) || defined(__linux)
+            return headers[i].msg_hdr.msg_namelen;
+#else
+            return addr_lens[i];
+#endif
+        }
+
+        /**
+         * @brief Get the peer address of a slot as a socket_address
+         * @param i Slot index, < size()
+         * @return Sender (after receive) or destination (after push)
+         *
+         * Copies the raw address into an inline socket_address; does not allocate.
+         */
+        socket_address peer(std::size_t i) const;
+
+        /**
+         * @brief Appends a datagram to send, copying it into the next slot
+         * @param to Destination address
+         * @param to_len Size of the destination address
+         * @param data Payload
+         * @param len Payload size, at most datagram_size()
+         * @return false if the batch is full
+         * @throws socket_exception with type "DatagramTooLarge" if len > datagram_size()
+         */
+        bool push(const sockaddr *to, socklen_t to_len, const char *data, std::size_t len);
+
+        /**
+         * @brief Appends a datagram to send, copying it into the next slot
+         * @param to Destination address
+         * @param payload Payload, at most datagram_size() bytes
+         * @return false if the batch is full
+         * @throws socket_exception with type "DatagramTooLarge" if the payload does not fit a slot
+         */
+        bool push(const socket_address &to, std::string_view payload)
+        {
+            return push(to.get_sock_addr(), to.get_sock_addr_len(), payload.data(), payload.size());
+        }
+    };
+}
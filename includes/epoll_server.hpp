@@ -24,7 +24,9 @@
  * @note This implementation is Linux-specific and will not compile on other platforms
  */
 
+#include <atomic>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -43,13 +45,75 @@
 #include "tcp_server.hpp"
 #include "socket.hpp"
 #include "connection.hpp"
+#include "connection_handle.hpp"
+#include "connection_table.hpp"
 #include "data_buffer.hpp"
+#include "datagram_batch.hpp"
+#include "buffer_pool.hpp"
+#include "file_descriptor.hpp"
+#include "ip_filter.hpp"
+#include "ip_limiter.hpp"
+#include "mpsc_queue.hpp"
+#include "timer_wheel.hpp"
+#include "worker_pool.hpp"
 
-/// Custom epoll event used to signal connection closure
+/// Custom epoll event formerly used to signal connection closure.
+/// Close requests are now tracked with epoll_connection::want_close; kept for source compatibility.
 const unsigned int HAMZA_CUSTOM_CLOSE_EVENT = 3545940;
 
 namespace hh_socket
 {
+    /**
+     * @brief A range of a file queued for sending with send_file()
+     *
+     * The bytes are never read into user space: the write path hands them
+     * from the page cache to the socket with sendfile(2).
+     */
+    struct file_segment
+    {
+        /// Duplicated descriptor of the file, closed when the last segment using it is dropped
+        std::shared_ptr<file_descriptor> file;
+
+        /// File offset of the next byte to send
+        uint64_t offset = 0;
+
+        /// Bytes of the segment not yet sent
+        std::size_t remaining = 0;
+
+        /// Position of the next byte to send in the connection's output stream
+        uint64_t stream_pos = 0;
+    };
+
+    /**
+     * @brief Buffers referenced by one MSG_ZEROCOPY send, kept alive until the kernel releases them
+     */
+    struct zerocopy_hold
+    {
+        /// Sequence number the kernel assigned to the send
+        uint32_t seq = 0;
+
+        /// Messages whose bytes the kernel may still read
+        std::vector<data_buffer> buffers;
+    };
+
+    /**
+     * @brief MSG_ZEROCOPY counters of an epoll_server, see set_zerocopy_threshold()
+     */
+    struct zerocopy_stats
+    {
+        /// sendmsg() calls made with MSG_ZEROCOPY
+        uint64_t sends = 0;
+
+        /// Sends the kernel reported as completed without copying
+        uint64_t completed = 0;
+
+        /// Sends the kernel reported as completed with a copy (e.g. loopback, no NIC support)
+        uint64_t copied = 0;
+
+        /// Sends made with a copy because MSG_ZEROCOPY was refused (ENOBUFS)
+        uint64_t refused = 0;
+    };
+
     /**
      * @brief Connection state structure for epoll-managed connections
      *
@@ -62,14 +126,229 @@ namespace hh_socket
         /// Shared pointer to the connection object
         std::shared_ptr<connection> conn;
 
-        /// Queue of pending outbound messages waiting to be sent
-        std::deque<std::string> outq; // queued writes
+        /// Queue of pending outbound messages waiting to be sent (shared slices, never copied)
+        std::deque<data_buffer> outq; // queued writes
+
+        /// Bytes of outq.front() already written to the socket (partial write progress)
+        std::size_t out_offset = 0;
 
         /// Flag indicating if the connection wants to write (EPOLLOUT enabled)
         bool want_write = false;
 
         /// Flag indicating if the connection wants to close, meant to be set by user
         bool want_close = false;
+
+        /// Flag indicating the application asked to stop reading from this connection
+        bool read_stopped = false;
+
+        /// Flag indicating the connection is already in the pending-write list
+        bool flush_pending = false;
+
+        /// Flag indicating queued output is dropped and the connection closed without flushing
+        bool want_abort = false;
+
+        /// Fires at the earliest idle/read/write deadline of this connection
+        timer deadline;
+
+        /// Loop time (ms) of the last received data
+        uint64_t last_read = 0;
+
+        /// Loop time (ms) of the last write progress, or when output was queued on an empty queue
+        uint64_t last_write = 0;
+
+        /// Idle timeout in ms (no reads and no writes), 0 disables
+        uint32_t idle_timeout = 0;
+
+        /// Read timeout in ms (no data received), 0 disables
+        uint32_t read_timeout = 0;
+
+        /// Write timeout in ms (queued output makes no progress), 0 disables
+        uint32_t write_timeout = 0;
+
+        /// Bytes queued by send_message() and not yet written to the socket
+        std::size_t out_bytes = 0;
+
+        /// Output size that blocks the connection (pauses reading), 0 disables
+        std::size_t high_watermark = 0;
+
+        /// Output size at or below which a blocked connection resumes
+        std::size_t low_watermark = 0;
+
+        /// Flag set between crossing the high watermark and draining to the low one; reading is paused meanwhile
+        bool write_blocked = false;
+
+        /// Flag indicating EPOLLIN is part of the registered interest (dropped while write_blocked)
+        bool read_interest = true;
+
+        /// File segments queued by send_file(), ordered against outq by output stream position
+        std::deque<file_segment> out_files;
+
+        /// Bytes ever queued (buffers and files): stream position of the next queued byte
+        uint64_t out_queued = 0;
+
+        /// Bytes ever written to the socket: stream position of the next byte to send
+        uint64_t out_written = 0;
+
+        /// SO_ZEROCOPY state of the socket: 0 not enabled yet, 1 enabled, -1 unsupported
+        int8_t zerocopy = 0;
+
+        /// Sequence number the kernel assigns to the next MSG_ZEROCOPY send on this socket
+        uint32_t zc_next_seq = 0;
+
+        /// Buffers pinned by MSG_ZEROCOPY sends, in sequence order, until the kernel's completion
+        std::deque<zerocopy_hold> zc_holds;
+
+        /// Flag indicating the connection is counted by the loop's ip_limiter and must be released on close
+        bool ip_counted = false;
+
+        /// Orders this connection's messages on the worker pool; created on first use
+        std::shared_ptr<worker_pool::strand> strand;
+
+        /// Check whether buffers or file segments are waiting to be sent
+        bool has_output() const { return !outq.empty() || !out_files.empty(); }
+
+        /// Check whether a requested close can happen now: output flushed and, unless aborting, zerocopy sends completed
+        bool ready_to_close() const { return want_close && !has_output() && (zc_holds.empty() || want_abort); }
+
+        /// Check whether the next byte to send belongs to a file segment
+        bool file_at_head() const { return !out_files.empty() && out_files.front().stream_pos == out_written; }
+
+        /**
+         * @brief Returns the state to its just-constructed values, keeping allocated storage
+         *
+         * Used when a closed connection's state is retired for reuse. The
+         * queues are emptied but keep their chunk storage; the connection
+         * object is kept only if nothing else references it. Fields added
+         * to this struct must be reset here too.
+         */
+        void recycle();
+    };
+
+    /**
+     * @brief Reuse counters of an epoll_server's connection pool
+     *
+     * See epoll_server::set_connection_pool_limit().
+     */
+    struct connection_pool_stats
+    {
+        /// Connections whose epoll_connection state came from a retired slot
+        uint64_t states_reused = 0;
+
+        /// Connections whose epoll_connection state was constructed fresh
+        uint64_t states_allocated = 0;
+
+        /// Connections that reinitialised a retired connection object in place
+        uint64_t connections_reused = 0;
+
+        /// Connections that allocated a new connection object
+        uint64_t connections_allocated = 0;
+    };
+
+    /**
+     * @brief Load counters of an epoll_server loop, readable from any thread
+     *
+     * See epoll_server::get_load(). Counters only grow; sample them twice
+     * to get rates.
+     */
+    struct loop_load
+    {
+        /// Open connections
+        std::size_t connections = 0;
+
+        /// Readiness events handled since the loop was created
+        uint64_t events = 0;
+
+        /// Connections handed to other loops
+        uint64_t migrated_out = 0;
+
+        /// Connections taken over from other loops
+        uint64_t migrated_in = 0;
+
+        /// Sockets handed over by an acceptor thread and taken by this loop
+        uint64_t handoffs = 0;
+
+        /// Datagrams on registered UDP sockets dropped for exceeding their datagram_size
+        uint64_t truncated_datagrams = 0;
+    };
+
+    /**
+     * @brief Outbound datagram queued by epoll_server::send_datagram()
+     */
+    struct udp_datagram
+    {
+        /// Destination address
+        socket_address to;
+
+        /// Payload (shared slice, never copied)
+        data_buffer data;
+    };
+
+    /**
+     * @brief Request posted to an epoll_server loop from another thread
+     *
+     * Created by epoll_server::post_send(), post_close(), post() and the
+     * default on_worker_message(), and run by the loop when it drains its
+     * command queue.
+     */
+    struct loop_command
+    {
+        /// What the loop does with the command
+        enum class kind : uint8_t
+        {
+            send,    ///< send_message(target, data)
+            close,   ///< close_connection(target)
+            task,    ///< task()
+            accept,  ///< accept_conn(accepted, peer)
+            message, ///< on_message_received(target, data)
+        };
+
+        kind type = kind::task;
+
+        /// Connection a send, close or message applies to
+        connection_handle target;
+
+        /// Payload of a send or message
+        data_buffer data;
+
+        /// Function run by a task
+        std::function<void()> task;
+
+        /// Socket accepted by another thread, for an accept
+        int accepted = -1;
+
+        /// Remote address of accepted
+        sockaddr_storage peer{};
+    };
+
+    /**
+     * @brief State of a UDP socket registered on an epoll_server loop
+     */
+    struct udp_endpoint
+    {
+        /// The registered socket
+        std::shared_ptr<socket> sock;
+
+        /// Receive slots, refilled by one recvmmsg() per batch
+        datagram_batch in;
+
+        /// Datagrams waiting for socket buffer space
+        std::deque<udp_datagram> outq;
+
+        /// Flag indicating the endpoint is already in the pending-write list
+        bool flush_pending = false;
+
+        udp_endpoint(std::shared_ptr<socket> sock, std::size_t datagram_size)
+            : sock(std::move(sock)), in(64, datagram_size) {}
+    };
+
+    /**
+     * @brief Which connection deadline expired, passed to epoll_server::on_connection_timeout()
+     */
+    enum class timeout_kind
+    {
+        idle,  ///< Nothing was read or written for the idle timeout
+        read,  ///< Nothing was received for the read timeout
+        write, ///< Queued output made no progress for the write timeout
     };
 
     /**
@@ -104,6 +383,9 @@ namespace hh_socket
      */
     class epoll_server : public tcp_server
     {
+        /// The io_uring backend drives the same connection state with a different loop
+        friend class io_uring_server;
+
     private:
 #if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
         HANDLE epoll_fd = INVALID_HANDLE_VALUE;
@@ -115,11 +397,92 @@ namespace hh_socket
         /// Shared pointer to the listening socket
         std::shared_ptr<socket> listener_socket;
 
+        /// UDP sockets served by the loop, indexed by fd
+        connection_table<udp_endpoint> udp_endpoints;
+
+        /// UDP endpoints with datagrams queued since the last flush pass
+        std::vector<int> udp_pending;
+
+        /// Datagrams an endpoint may queue before send_datagram() drops new ones
+        static const std::size_t UDP_QUEUE_LIMIT = 4096;
+
+        /**
+         * @brief Reads every queued datagram of a UDP endpoint and dispatches on_datagram()
+         * @param u Endpoint whose socket is readable
+         */
+        void try_read_datagrams(udp_endpoint &u);
+
+        /**
+         * @brief Sends the queued datagrams of a UDP endpoint
+         * @param u Endpoint to flush
+         *
+         * Stops at EAGAIN and resumes on the next EPOLLOUT edge. A datagram
+         * the kernel rejects (EMSGSIZE, ICMP errors reported on the socket)
+         * is dropped.
+         */
+        void flush_datagrams(udp_endpoint &u);
+
         /// Vector of epoll events for batch event processing
         std::vector<epoll_event> events;
 
-        /// Atomic flag for graceful shutdown signaling
-        volatile sig_atomic_t g_stop = 0;
+        /// Atomic flag for graceful shutdown signaling, may be set from any thread
+        std::atomic<bool> g_stop{false};
+
+        /// Commands posted from other threads, drained by the loop
+        mpsc_queue<loop_command> commands;
+
+        /// eventfd (wepoll: loopback UDP socket) registered with the loop; written to wake it for posted commands
+        int wake_fd = -1;
+
+        /// Set by the first post after a drain; later posts skip the eventfd write
+        std::atomic<bool> wake_pending{false};
+
+        /**
+         * @brief Makes the loop return from its wait, once per batch of posts
+         *
+         * Writes the eventfd only if no wakeup is pending since the loop
+         * last drained the queue. Safe from any thread.
+         */
+        void wake();
+
+        /**
+         * @brief Runs the commands posted since the last drain
+         *
+         * Called on the loop thread when wake_fd is readable. At most a
+         * bounded number of commands run per call, so a task that keeps
+         * posting cannot starve I/O; the rest wait for the next wakeup.
+         */
+        void drain_commands();
+
+        /**
+         * @brief Runs one command on the loop thread
+         * @param cmd Command; a send, close or message for a connection that
+         *        migrated away is forwarded to its new loop
+         */
+        void run_command(loop_command &cmd);
+
+        /// Where a connection moved by migrate_idle_connections() went
+        struct migration_forward
+        {
+            /// Generation of the connection's slot on this loop
+            uint32_t generation = 0;
+
+            /// Loop that adopted it
+            epoll_server *target = nullptr;
+
+            /// Handle on target, set by target when it adopts the connection
+            std::shared_ptr<connection_handle> handle;
+        };
+
+        /// Moved connections by fd; an entry lives until the fd is opened or adopted here again
+        std::unordered_map<int, migration_forward> forwards;
+
+        /**
+         * @brief Re-posts a command for a migrated connection to the loop that has it
+         * @param cmd Send, close or message whose target no longer resolves here
+         * @return true if it was forwarded, false if the connection is simply gone
+         */
+        bool forward_command(const loop_command &cmd);
 
         /// Current number of open connections
         std::size_t current_open_connections = 10;
@@ -127,13 +490,294 @@ namespace hh_socket
         /// Maximum number of file descriptors, if failed setting to the specified max
         std::size_t max_fds = 1024;
 
+        /// Receive blocks lent to read_block; a block returns once all its slices are released
+        buffer_pool recv_pool;
+
+        /// Block that incoming data is received into; slices of it are handed to on_message_received()
+        std::shared_ptr<std::string> read_block;
+
+        /// Bytes of read_block already handed out
+        std::size_t read_used = 0;
+
+        /// Connection deadlines and user timers, driven by the event loop
+        timer_wheel timers;
+
+        /// Cached clock (ms) read once per loop iteration, used to stamp I/O activity
+        uint64_t loop_time = timer_wheel::clock_ms();
+
+        /// Timers created by schedule_after()/schedule_every(), by id
+        std::unordered_map<uint64_t, std::unique_ptr<timer>> user_timers;
+
+        /// Finished or cancelled user timers, freed once the wheel is done running them
+        std::vector<std::unique_ptr<timer>> retired_timers;
+
+        /// Next id returned by schedule_after()/schedule_every()
+        uint64_t next_timer_id = 1;
+
+        /// Default timeouts (ms) applied to new connections, 0 disables
+        uint32_t default_idle_timeout = 0;
+        uint32_t default_read_timeout = 0;
+        uint32_t default_write_timeout = 0;
+
+        /// Default per-connection output watermarks (bytes) applied to new connections, high 0 disables
+        std::size_t default_high_watermark = 0;
+        std::size_t default_low_watermark = 0;
+
+        /// Output watermarks (bytes) over all connections of this loop, high 0 disables
+        std::size_t global_high_watermark = 0;
+        std::size_t global_low_watermark = 0;
+
+        /// Bytes queued by send_message() over all connections and not yet written
+        std::size_t total_out_bytes = 0;
+
+        /// Set while some connection stays blocked only because of the global watermark
+        bool global_blocked = false;
+
+        /// Gathered write size from which MSG_ZEROCOPY is used, 0 disables
+        std::size_t zerocopy_threshold = 0;
+
+        /// MSG_ZEROCOPY counters
+        zerocopy_stats zc_stats;
+
+        /**
+         * @brief Enables SO_ZEROCOPY on a connection's socket the first time it is needed
+         * @param c Connection about to send with MSG_ZEROCOPY
+         * @return true if the socket supports MSG_ZEROCOPY
+         */
+        bool enable_zerocopy(epoll_connection &c);
+
+        /**
+         * @brief Reads MSG_ZEROCOPY completions from the socket error queue
+         * @param c Connection with zerocopy sends in flight
+         * @return false if the socket also reports a real error
+         *
+         * Releases the held buffers of every completed send and updates
+         * the counters.
+         */
+        bool drain_zerocopy(epoll_connection &c);
+
+        /**
+         * @brief Adds queued output to the byte counts and blocks the connection at the high watermark
+         * @param c Connection that queued output
+         * @param n Number of bytes queued
+         */
+        void account_queued(epoll_connection &c, std::size_t n);
+
+        /**
+         * @brief Removes written (or discarded) output from the byte counts
+         * @param c Connection the bytes belonged to
+         * @param n Number of bytes
+         *
+         * When the global count drains to its low watermark, every blocked
+         * connection is scheduled for a flush pass so it can resume.
+         */
+        void account_written(epoll_connection &c, std::size_t n);
+
+        /**
+         * @brief Unblocks a connection whose output drained to the low watermarks
+         * @param c Blocked connection
+         * @return true if the connection was unblocked; the caller resumes
+         *         reading and then calls on_write_drained()
+         */
+        bool release_write_block(epoll_connection &c);
+
+        /**
+         * @brief Arms a connection's timer at its earliest pending deadline
+         * @param c Connection whose deadline timer should be (re)armed
+         *
+         * Reads and writes only record loop_time; the timer is moved lazily
+         * when it fires early, so activity never touches the wheel.
+         */
+        void arm_deadline(epoll_connection &c);
+
+        /**
+         * @brief Handles a connection's deadline timer
+         * @param fd File descriptor of the connection
+         *
+         * Reports the expired deadline through on_connection_timeout(), or
+         * re-arms the timer at the next deadline after recent activity.
+         */
+        void on_deadline(int fd);
+
+        /**
+         * @brief Reads the clock and runs every expired timer
+         */
+        void run_timers();
+
         /// @brief  tries to accept connections
         void try_accept();
 
+        /// Accept filter, possibly shared with other loops; null accepts every peer
+        std::shared_ptr<ip_filter> accept_filter;
+
+        /// Rule set this loop evaluates, refreshed when accept_filter's version changes
+        std::shared_ptr<const ip_filter_rules> accept_rules;
+
+        /// accept_filter version accept_rules was taken from
+        uint64_t accept_rules_version = 0;
+
+        /// Accepted sockets closed because the filter denied their peer
+        uint64_t filtered_count = 0;
+
+        /// Per-IP connection counts and accept buckets of this loop
+        ip_limiter accept_limiter;
+
+        /// Maximum number of closed connections' states kept for reuse, 0 disables pooling
+        std::size_t pool_limit = 1024;
+
+        /// Reuse vs fresh allocation counters of the connection pool
+        connection_pool_stats pool_stats;
+
+        /**
+         * @brief Evaluates the accept filter and the per-IP limits for a freshly accepted socket
+         * @param cfd Accepted socket
+         * @param client_addr Peer address returned by accept
+         * @return true if the peer is allowed and within its limits
+         *
+         * Runs before open_conn(): a refused socket gets no connection object
+         * and no callback, the caller just closes it. With
+         * ip_limits::reset_over_limit an over-limit socket is set to linger 0
+         * first, so the close sends a reset.
+         */
+        bool admit_peer(socket_t cfd, const sockaddr_storage &client_addr);
+
+        /**
+         * @brief Starts tracking an accepted client socket
+         * @param cfd Accepted, non-blocking client file descriptor
+         * @param client_addr Remote address returned by accept
+         *
+         * Creates the connection object, inserts it into the connection table
+         * and calls on_connection_opened(). The caller registers cfd with its
+         * I/O backend.
+         */
+        void open_conn(int cfd, sockaddr_storage &client_addr);
+
+        /**
+         * @brief Admits, opens and registers a socket accepted by this loop or handed over
+         * @param cfd Accepted, non-blocking client file descriptor; owned from here on
+         * @param client_addr Remote address returned by accept
+         * @throws std::runtime_error if the socket cannot be added to the epoll set
+         *
+         * Runs admit_peer() and closes cfd if it refuses, else open_conn()
+         * and registration with the I/O backend (overridden by
+         * io_uring_server to arm a recv instead).
+         */
+        virtual void accept_conn(socket_t cfd, sockaddr_storage &client_addr);
+
         /// @brief  Tries to read data from a connection
         /// @param c Reference to the epoll_connection to read from
         void try_read(epoll_connection &c);
 
+        /**
+         * @brief Reads a connection until EAGAIN, handing each chunk to a dispatch
+         * @param c Connection to read from
+         * @param dispatch Callback dispatch, see epoll_server_loop.hpp
+         *
+         * try_read() is this with virtual_dispatch.
+         */
+        template <class Dispatch>
+        void read_stream(epoll_connection &c, Dispatch &dispatch);
+
+        /// Handle of a connection's state, built from its table slot
+        connection_handle handle_of(const epoll_connection &c) const
+        {
+            int fd = c.conn->get_fd();
+            return {fd, conns.generation(fd)};
+        }
+
+        /**
+         * @brief Appends a message to a connection's output queue
+         * @param c Connection state
+         * @param db Data buffer containing the message to send
+         */
+        void queue_message(epoll_connection &c, const data_buffer &db);
+
+        /// Pool running on_worker_message(), null to handle messages on the loop
+        std::shared_ptr<worker_pool> workers;
+
+        /// Messages handed to the pool whose on_worker_message() has not returned
+        std::atomic<std::size_t> offloaded{0};
+
+        /**
+         * @brief Hands a received chunk to the application
+         * @param c Connection that received it
+         * @param db The chunk
+         *
+         * Calls on_message_received() on the loop, or queues
+         * on_worker_message() on the connection's strand when a worker pool
+         * is set.
+         */
+        void deliver_message(epoll_connection &c, const data_buffer &db)
+        {
+            if (workers)
+                offload_message(c, db);
+            else
+                on_message_received(handle_of(c), db);
+        }
+
+        /// Queues on_worker_message() for a chunk on the connection's strand
+        void offload_message(epoll_connection &c, const data_buffer &db);
+
+        /// Blocks until every on_worker_message() call on this server returned; run when the loop stops
+        void wait_offloaded();
+
+        // Mirrors of the loop's load for other threads, see get_load()
+        std::atomic<std::size_t> load_connections{0};
+        std::atomic<uint64_t> load_events{0};
+        std::atomic<uint64_t> load_migrated_out{0};
+        std::atomic<uint64_t> load_migrated_in{0};
+        std::atomic<uint64_t> load_handoffs{0};
+        std::atomic<uint64_t> load_truncated{0};
+
+        /// Adds to a counter only the loop thread writes
+        static void bump(std::atomic<uint64_t> &counter, uint64_t n)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Check whether a connection may move to another loop now
+         * @param c Connection state
+         * @param min_idle_ms Time without reads or writes required
+         * @return true if it is idle and no loop-local operation is in flight
+         *
+         * Excluded: pending close, paused by watermarks, MSG_ZEROCOPY sends
+         * awaiting completion, messages queued or running on the worker pool.
+         */
+        bool can_migrate(const epoll_connection &c, uint64_t min_idle_ms) const;
+
+        /**
+         * @brief Takes over connections detached by another loop
+         * @param states Connection states, moved from
+         * @param handles One per state, filled in with the connection's handle on this loop
+         *
+         * Runs on this loop's thread (posted by migrate_idle_connections()).
+         */
+        void adopt_connections(std::vector<epoll_connection> &states,
+                               const std::vector<std::shared_ptr<connection_handle>> &handles);
+
+        /// epoll_event.data.u64 layout: slot generation in the high half, fd in the low half
+        static uint64_t make_event_token(int fd, uint32_t gen)
+        {
+            return (static_cast<uint64_t>(gen) << 32) | static_cast<uint32_t>(fd);
+        }
+
+        /// File descriptor of an epoll_event token
+        static int event_token_fd(uint64_t data) { return static_cast<int>(static_cast<uint32_t>(data)); }
+
+        /// Slot generation of an epoll_event token
+        static uint32_t event_token_gen(uint64_t data) { return static_cast<uint32_t>(data >> 32); }
+
+        /**
+         * @brief Makes sure read_block has room for the next recv
+         * @return Number of free bytes at the end of read_block
+         *
+         * Consecutive reads are placed one after another in the same block,
+         * so the slices handed out never overlap; the next block is taken from
+         * recv_pool once less than a quarter of it is left.
+         */
+        std::size_t prepare_read_block();
+
 #if (defined(__linux__) || defined(__linux))
         /**
          * @brief Sets file descriptor limit for the process
@@ -154,6 +798,8 @@ namespace hh_socket
          *
          * Registers a file descriptor with the epoll instance for event monitoring.
          * Uses edge-triggered mode (EPOLLET) for maximum performance.
+         * The event data carries the fd and its conns slot generation, so
+         * connection state must be created before the fd is added.
          */
         int add_epoll(int fd, uint32_t ev);
 
@@ -190,34 +836,125 @@ namespace hh_socket
          */
         void close_conn(int fd);
 
+        /**
+         * @brief Drops a connection's queued output and closes it on the next flush pass
+         * @param c Connection to abort
+         */
+        void abort_conn(epoll_connection &c);
+
+        /**
+         * @brief Writes the file segment at the head of a connection's output
+         * @param c Connection whose file_at_head() is true
+         * @return true if the segment was fully sent (or the connection aborted),
+         *         false if the socket buffer is full
+         *
+         * Uses sendfile(2), so the file's bytes never enter user space. A
+         * read error or a file shorter than the queued segment aborts the
+         * connection, since the promised bytes can never be delivered.
+         */
+        bool flush_file(epoll_connection &c);
+
         /**
          * @brief Attempts to flush pending writes for a connection
          * @param c Reference to the epoll_connection to flush
          * @return true if all data was sent, false if more data remains
          *
-         * Tries to send all queued data for a connection. Handles partial sends
-         * gracefully by updating the queue. Returns false if EAGAIN/EWOULDBLOCK
-         * is encountered, indicating the socket buffer is full.
+         * Tries to send all queued data for a connection. On Linux the queue is
+         * gathered into one sendmsg() call of up to IOV_MAX segments, so many
+         * small pipelined responses cost a single syscall. Partial sends are
+         * tracked with out_offset instead of erasing the sent prefix. Returns
+         * false if EAGAIN/EWOULDBLOCK is encountered, indicating the socket
+         * buffer is full.
          */
         bool flush_writes(epoll_connection &c);
 
+        /**
+         * @brief Drops bytes that were written from the front of the output queue
+         * @param c Reference to the epoll_connection that was written to
+         * @param n Number of bytes the kernel accepted
+         *
+         * Pops every fully written message and leaves out_offset pointing into
+         * the first message that was only partially written.
+         */
+        void consume_written(epoll_connection &c, std::size_t n);
+
+        /// Connections with output queued (or a close requested) since the last flush pass
+        std::vector<int> pending_flush;
+
+        /// Scratch list swapped with pending_flush while it is being processed
+        std::vector<int> pending_swap;
+
+        /**
+         * @brief Flushes a connection and toggles EPOLLOUT interest as needed
+         * @param c Reference to the epoll_connection to flush
+         *
+         * EPOLLOUT stays registered only while data remains queued and
+         * EPOLLIN only while the connection is not write-blocked; epoll_ctl
+         * is only called when that state changes. Resumes a blocked
+         * connection that drained and calls on_write_drained().
+         */
+        void flush_and_update_interest(epoll_connection &c);
+
+        /**
+         * @brief Records a connection for the next pending-write pass
+         * @param c Reference to the epoll_connection with new output
+         */
+        void schedule_flush(epoll_connection &c);
+
+        /**
+         * @brief Flushes every connection recorded by schedule_flush()
+         *
+         * Runs before each epoll_wait, so all responses produced while
+         * handling one batch of events are written with one gathered write
+         * per connection, and deferred closes are carried out.
+         */
+        void flush_pending_writes();
+
         /**
          * @brief Main event loop using epoll_wait
          * @param timeout Timeout in milliseconds for epoll_wait (-1 for blocking)
          *
-         * The core of the server - runs the event loop that:
-         * - Waits for events using epoll_wait
-         * - Handles new connections (accept loop)
-         * - Processes incoming data
-         * - Manages outgoing data and flow control
-         * - Handles connection closures
-         * - Manages epoll event buffer resizing
+         * The core of the server - runs the event loop that:
+         * - Waits for events using epoll_wait
+         * - Handles new connections (accept loop)
+         * - Processes incoming data
+         * - Manages outgoing data and flow control
+         * - Handles connection closures
+         * - Manages epoll event buffer resizing
+         */
+        void epoll_loop(int timeout = 1000);
+
+    protected:
+        /**
+         * @brief Dispatch of the default loop: the virtual callbacks
+         *
+         * Delivers through the connection_handle overload of
+         * on_message_received(), whose default forwards to the shared_ptr one.
+         */
+        struct virtual_dispatch
+        {
+            epoll_server &server;
+
+            void message(epoll_connection &c, const data_buffer &db) { server.deliver_message(c, db); }
+
+            void waiting() { server.on_waiting_for_activity(); }
+        };
+
+        /**
+         * @brief Runs the event loop with the given callback dispatch until stop_server()
+         * @param dispatch Receives every chunk read and the per-iteration hook
+         * @param timeout Timeout in milliseconds for epoll_wait (-1 for blocking)
+         *
+         * Defined in epoll_server_loop.hpp. epoll_loop() runs it with
+         * virtual_dispatch; static_epoll_server runs it with a dispatch that
+         * calls its handler without virtual calls. Callbacks other than
+         * message() and waiting() always go through the virtual functions.
          */
-        void epoll_loop(int timeout = 1000);
+        template <class Dispatch>
+        void run_loop(Dispatch &dispatch, int timeout);
 
-    protected:
-        /// Map of file descriptors to their connection state
-        std::unordered_map<int, epoll_connection> conns;
+        /// Connection state indexed by file descriptor (flat, no per-connection allocation)
+        connection_table<epoll_connection> conns;
 
         /**
          * @brief Interface for derived classes to close a connection
@@ -232,6 +969,12 @@ namespace hh_socket
          */
         void close_connection(std::shared_ptr<connection> conn) override;
 
+        /**
+         * @brief Requests a connection given by reference to be closed
+         * @param conn Connection to close, once its queued output is flushed
+         */
+        void close_connection(const connection &conn) { close_connection(conn.get_fd()); }
+
         /**
          * @brief Stops reading from a connection (disables EPOLLIN)
          * @note it just sets want to stop to be true
@@ -246,6 +989,131 @@ namespace hh_socket
          */
         void close_connection(int fd);
 
+        /**
+         * @brief Get the handle of an open connection
+         * @param conn Connection owned by this loop
+         * @return Handle to pass around instead of the shared_ptr
+         */
+        connection_handle get_handle(const connection &conn) const
+        {
+            int fd = conn.get_fd();
+            return {fd, conns.generation(fd)};
+        }
+
+        /**
+         * @brief Resolves a handle
+         * @param h Handle issued by this loop
+         * @return The connection, or nullptr if it closed (or h is invalid)
+         *
+         * The pointer is valid until the connection closes; do not keep it
+         * across callbacks, keep the handle.
+         */
+        connection *get_connection(connection_handle h)
+        {
+            epoll_connection *c = conns.find(h.fd, h.generation);
+            return c ? c->conn.get() : nullptr;
+        }
+
+        /**
+         * @brief Takes shared ownership of a connection object
+         * @param h Handle issued by this loop
+         * @return The connection's shared_ptr, or null if it closed
+         *
+         * For code that must keep the connection object itself alive, e.g.
+         * beyond on_connection_closed(). Everything else should keep the handle.
+         */
+        std::shared_ptr<connection> share_connection(connection_handle h)
+        {
+            epoll_connection *c = conns.find(h.fd, h.generation);
+            return c ? c->conn : nullptr;
+        }
+
+        /**
+         * @brief Queues a message for the connection behind a handle
+         * @param h Handle issued by this loop
+         * @param db Data buffer containing the message to send
+         *
+         * A no-op if the connection has closed, even if its fd was reused.
+         */
+        void send_message(connection_handle h, const data_buffer &db);
+
+        /**
+         * @brief Requests the connection behind a handle to be closed
+         * @param h Handle issued by this loop; a no-op if it already closed
+         */
+        void close_connection(connection_handle h);
+
+        /**
+         * @brief Closes a connection without sending its queued output
+         * @param conn Shared pointer to the connection to abort
+         *
+         * Drops the output queue and closes on the next flush pass, even if
+         * the peer is not reading. Used for write timeouts.
+         */
+        void abort_connection(std::shared_ptr<connection> conn);
+
+        /**
+         * @brief Overrides the timeouts of a single connection
+         * @param conn Connection to configure
+         * @param idle Idle timeout (no reads and no writes), 0 disables
+         * @param read Read timeout (no data received), 0 disables
+         * @param write Write timeout (queued output makes no progress), 0 disables
+         *
+         * Deadlines are measured from the last matching activity. Typically
+         * called from on_connection_opened().
+         */
+        void set_connection_timeouts(std::shared_ptr<connection> conn, std::chrono::milliseconds idle,
+                                     std::chrono::milliseconds read, std::chrono::milliseconds write);
+
+        /**
+         * @brief Called when a connection deadline expires
+         * @param conn Connection whose deadline expired
+         * @param kind Which deadline expired
+         *
+         * Default implementation closes the connection: gracefully for idle
+         * and read timeouts, with abort_connection() for write timeouts. If
+         * an override keeps the connection open, the same deadline fires
+         * again after another full timeout.
+         *
+         * @note Virtual function - can be overridden by derived classes
+         */
+        virtual void on_connection_timeout(std::shared_ptr<connection> conn, timeout_kind kind);
+
+        /**
+         * @brief Overrides the output watermarks of a single connection
+         * @param conn Connection to configure
+         * @param high Queued bytes that block the connection, 0 disables
+         * @param low Queued bytes at or below which it resumes (clamped to high)
+         */
+        void set_connection_write_watermarks(std::shared_ptr<connection> conn, std::size_t high, std::size_t low);
+
+        /**
+         * @brief Called when a connection's queued output crosses a high watermark
+         * @param conn Connection whose output is blocked
+         *
+         * Reading from the connection is paused until on_write_drained().
+         * Called from send_message(), so a producer can stop generating
+         * output right away. A proxy would stop reading from the upstream
+         * peer here.
+         *
+         * @note Virtual function - can be overridden by derived classes
+         */
+        virtual void on_write_blocked(std::shared_ptr<connection>)
+        {
+        }
+
+        /**
+         * @brief Called when a blocked connection's output drained to the low watermarks
+         * @param conn Connection that can take output again
+         *
+         * Reading from the connection has already been resumed.
+         *
+         * @note Virtual function - can be overridden by derived classes
+         */
+        virtual void on_write_drained(std::shared_ptr<connection>)
+        {
+        }
+
         /**
          * @brief Interface for derived classes to send messages
          * @param conn Shared pointer to the target connection
@@ -261,6 +1129,65 @@ namespace hh_socket
          */
         void send_message(std::shared_ptr<connection> conn, const data_buffer &db) override;
 
+        /**
+         * @brief Queues a message for a connection given by reference
+         * @param conn Target connection, e.g. the one passed to a static_epoll_server handler
+         * @param db Data buffer containing the message to send
+         *
+         * Same as send_message(std::shared_ptr<connection>, ...), without
+         * touching the shared_ptr's reference count.
+         */
+        void send_message(const connection &conn, const data_buffer &db);
+
+        /**
+         * @brief Queues a range of a file for sending, without copying it through user space
+         * @param conn Shared pointer to the target connection
+         * @param file_fd Open, readable file descriptor (a regular file)
+         * @param offset File offset of the first byte to send
+         * @param length Number of bytes to send
+         * @throws socket_exception if the descriptor cannot be duplicated
+         *
+         * The segment is sent in order with the messages queued by
+         * send_message() before and after it, using sendfile(2) on Linux.
+         * The descriptor is duplicated, so the caller may close file_fd as
+         * soon as this returns. If the file turns out shorter than
+         * offset + length, the connection is aborted.
+         *
+         * @note File segments do not count towards the write watermarks: they
+         *       hold no memory
+         * @note On platforms without sendfile the range is read into a
+         *       data_buffer and queued with send_message()
+         */
+        void send_file(std::shared_ptr<connection> conn, int file_fd, uint64_t offset, std::size_t length);
+
+        /**
+         * @brief Called for every datagram received on a registered UDP socket
+         * @param sock Socket the datagram arrived on (pass it to send_datagram() to reply)
+         * @param from Sender address
+         * @param data Payload, a slice of the loop's receive block
+         *
+         * Only whole datagrams are delivered: one longer than the socket's
+         * datagram_size is dropped and counted in loop_load::truncated_datagrams.
+         *
+         * @note Virtual function - can be overridden by derived classes
+         */
+        virtual void on_datagram(std::shared_ptr<socket>, const socket_address &, const data_buffer &)
+        {
+        }
+
+        /**
+         * @brief Queues a datagram on a registered UDP socket
+         * @param sock Registered UDP socket to send from
+         * @param to Destination address
+         * @param data Payload
+         * @return false if the datagram was dropped: the socket is not registered or its queue is full
+         *
+         * Datagrams queued while handling a batch of events are sent
+         * together, with one sendmmsg() per 64 datagrams, before the next
+         * epoll_wait. When the socket buffer is full they wait for EPOLLOUT.
+         */
+        bool send_datagram(std::shared_ptr<socket> sock, const socket_address &to, const data_buffer &data);
+
         /**
          * @brief Called when an exception occurs during server operation
          * @param e The exception that occurred
@@ -285,6 +1212,18 @@ namespace hh_socket
          */
         virtual void on_connection_opened(std::shared_ptr<connection> conn) override;
 
+        /**
+         * @brief Called when a new client connection is established, with its handle
+         * @param h Handle of the new connection
+         *
+         * This is the overload the loop calls. The default resolves the handle
+         * and calls on_connection_opened(std::shared_ptr<connection>); override
+         * this one instead to avoid the reference count traffic.
+         *
+         * @note Virtual function - can be overridden by derived classes
+         */
+        virtual void on_connection_opened(connection_handle h);
+
         /**
          * @brief Called when a client connection is closed
          * @param conn Shared pointer to the closed connection
@@ -297,6 +1236,17 @@ namespace hh_socket
          */
         virtual void on_connection_closed(std::shared_ptr<connection> conn) override;
 
+        /**
+         * @brief Called when a client connection is closed, with its handle
+         * @param h Handle of the closing connection, still resolvable during the call
+         *
+         * This is the overload the loop calls. The default calls
+         * on_connection_closed(std::shared_ptr<connection>).
+         *
+         * @note Virtual function - can be overridden by derived classes
+         */
+        virtual void on_connection_closed(connection_handle h);
+
         /**
          * @brief Called when data is received from a client
          * @param conn Shared pointer to the connection that sent data
@@ -311,6 +1261,69 @@ namespace hh_socket
          */
         virtual void on_message_received(std::shared_ptr<connection> conn, const data_buffer &db) override;
 
+        /**
+         * @brief Called when data is received from a client, with its handle
+         * @param h Handle of the connection that sent data
+         * @param db Data buffer containing the received data
+         *
+         * This is the overload the loop calls for every received chunk. The
+         * default resolves the handle and calls
+         * on_message_received(std::shared_ptr<connection>, ...), which copies
+         * the shared_ptr; override this one and reply with
+         * send_message(h, ...) to keep the per-message path free of atomics.
+         *
+         * @note Virtual function - can be overridden by derived classes
+         */
+        virtual void on_message_received(connection_handle h, const data_buffer &db);
+
+        /**
+         * @brief Called on a worker thread for data received while a worker pool is set
+         * @param h Handle of the connection that sent data
+         * @param db Data buffer containing the received data; safe to keep
+         *
+         * Replaces on_message_received() once set_worker_pool() was called.
+         * Calls for one connection run one at a time, in the order the data
+         * arrived; calls for different connections run in parallel.
+         *
+         * Only the thread-safe API may be used here: reply with
+         * post_send(h, ...), close with post_close(h), and post() anything
+         * else that must run on the loop. The default posts the chunk back
+         * to on_message_received() on the loop (following the connection
+         * if it migrated meanwhile).
+         *
+         * @note Virtual function - override to move message handling off the loop
+         */
+        virtual void on_worker_message(connection_handle h, const data_buffer &db);
+
+        /**
+         * @brief Called on the old loop right before a connection moves to another loop
+         * @param h Handle on this loop, invalid once the call returns
+         *
+         * Move per-connection application state kept in this server
+         * object to the destination here. The connection object itself
+         * moves with the connection, so shared_ptrs to it stay valid.
+         * on_connection_closed() is not called.
+         *
+         * @note Virtual function - can be overridden by derived classes
+         */
+        virtual void on_connection_migrated_out(connection_handle h);
+
+        /**
+         * @brief Called on the new loop once a migrated connection is registered
+         * @param h Handle of the connection on this loop
+         *
+         * on_connection_opened() is not called again.
+         *
+         * @note Virtual function - can be overridden by derived classes
+         */
+        virtual void on_connection_migrated_in(connection_handle h);
+
+        /**
+         * @brief Check whether this server can hand over or take connections
+         * @return true for the epoll backend
+         */
+        virtual bool supports_migration() const { return true; }
+
         /**
          * @brief Called when the server successfully starts listening
          *
@@ -410,6 +1423,29 @@ namespace hh_socket
          */
         virtual bool register_listener_socket(std::shared_ptr<socket> sock_ptr);
 
+        /**
+         * @brief Serves a bound UDP socket on this loop
+         * @param sock_ptr Bound UDP socket; it is switched to non-blocking mode
+         * @param datagram_size Largest datagram accepted; longer ones are dropped (default: 2048)
+         * @return true if the socket was added to the loop
+         *
+         * Any number of UDP sockets can be served next to the TCP listener.
+         * Readable sockets are drained in batches of up to 64 datagrams per
+         * recvmmsg(), and each datagram is passed to on_datagram(). A
+         * datagram longer than datagram_size is dropped rather than passed
+         * on cut short; get_load() reports how many were.
+         *
+         * @note Call before listen(), or from the loop thread
+         * @note io_uring_server serves UDP sockets only when it falls back to epoll
+         */
+        bool register_udp_socket(std::shared_ptr<socket> sock_ptr, std::size_t datagram_size = 2048);
+
+        /**
+         * @brief Stops serving a UDP socket; queued datagrams are discarded
+         * @param sock_ptr Socket previously passed to register_udp_socket()
+         */
+        void unregister_udp_socket(std::shared_ptr<socket> sock_ptr);
+
         /**
          * @brief Signals the server to stop gracefully
          *
@@ -417,8 +1453,297 @@ namespace hh_socket
          * after processing current events.
          *
          * @note Overrides tcp_server::stop_server
-         * @note The server will stop after the current epoll_wait timeout expires
+         * @note Safe from any thread; wakes the loop, so it stops without waiting for the epoll_wait timeout
          */
         virtual void stop_server() override;
+
+        /**
+         * @brief Queues data on a connection from any thread
+         * @param h Handle issued by this loop
+         * @param db Data to send; shared, not copied
+         *
+         * The loop runs send_message(h, db) when it drains its command
+         * queue. Commands posted from one thread run in posting order.
+         * Nothing is sent if the connection closed meanwhile.
+         *
+         * @note Thread-safe; this is how results computed off the loop get back to it
+         */
+        void post_send(connection_handle h, data_buffer db);
+
+        /**
+         * @brief Requests a connection close from any thread
+         * @param h Handle issued by this loop
+         *
+         * The loop runs close_connection(h): queued output, including
+         * earlier post_send() data, is flushed first.
+         *
+         * @note Thread-safe
+         */
+        void post_close(connection_handle h);
+
+        /**
+         * @brief Runs a function on the loop thread
+         * @param task Function to run; may use every loop-thread API
+         *
+         * An exception thrown by the task is passed to on_exception_occurred().
+         *
+         * @note Thread-safe. Posts made before the loop starts run once it does.
+         */
+        void post(std::function<void()> task);
+
+        /**
+         * @brief Hands a socket accepted on another thread to this loop
+         * @param cfd Accepted socket, non-blocking; this loop owns it from now on
+         * @param peer Remote address returned by accept
+         *
+         * The loop treats it like one it accepted itself: the ip_filter and
+         * per-IP limits apply, then on_connection_opened() runs on the
+         * loop. Used by epoll_server_group's acceptor thread. A socket
+         * still queued when the server is destroyed is closed.
+         *
+         * @note Thread-safe
+         */
+        void post_accepted(int cfd, const sockaddr_storage &peer);
+
+        /**
+         * @brief Filters accepted connections by peer address
+         * @param filter CIDR allow/deny rules, may be shared by several loops; null removes the filter
+         *
+         * The peer of every accepted socket is checked right after accept4().
+         * Denied peers are closed at once: no connection object is created
+         * and on_connection_opened() is not called. Rules are replaced at
+         * runtime with ip_filter::set_rules(); the loop picks up the new set
+         * on its next accept.
+         *
+         * @note Call before listen(), or from the loop thread
+         */
+        void set_ip_filter(std::shared_ptr<ip_filter> filter);
+
+        /**
+         * @brief Get the number of accepted sockets closed by the ip_filter
+         * @return Count, to be read on the loop thread or after the loop stopped
+         */
+        uint64_t get_filtered_connections() const { return filtered_count; }
+
+        /**
+         * @brief Limits connections and accept rate per remote address
+         * @param limits Per-IP connection cap and token-bucket accept rate; all zero removes the limits
+         *
+         * Checked right after accept4(), after the ip_filter. A socket over
+         * its address's limit is closed at once (or reset, see
+         * ip_limits::reset_over_limit): no connection object is created and
+         * on_connection_opened() is not called. Counts are per loop.
+         *
+         * @note Call before listen(), or from the loop thread
+         */
+        void set_ip_limits(const ip_limits &limits) { accept_limiter.set_limits(limits); }
+
+        /**
+         * @brief Access the per-IP limiter of this loop
+         * @return Reference to the limiter, e.g. to read its stats or per-address counts
+         */
+        const ip_limiter &get_ip_limiter() const { return accept_limiter; }
+
+        /**
+         * @brief Get this loop's load counters
+         * @return Snapshot; safe from any thread
+         */
+        loop_load get_load() const;
+
+        /**
+         * @brief Moves idle connections of this loop to another loop
+         * @param target Destination loop, running on another thread
+         * @param max_count Most connections to move
+         * @param min_idle Time a connection must have had no reads or writes
+         * @return Number of connections detached and handed to target
+         *
+         * Each chosen connection is removed from this loop's epoll set and
+         * connection table without closing its fd. Its epoll_connection
+         * state moves to target as is, including pending output, timeouts
+         * and watermarks. target registers it with post(), so the whole
+         * batch costs one wakeup. Data that arrives in between is reported
+         * by target's epoll when the fd is added.
+         *
+         * Handles issued by this loop stop resolving here. Sends and closes
+         * posted to this loop against such a handle (post_send(),
+         * post_close(), and the default on_worker_message()) are forwarded
+         * to target for as long as the connection lives there, so replies
+         * computed on other threads are not lost. Tasks from post() are run
+         * here as usual; use the new handle from on_connection_migrated_in()
+         * for anything else.
+         *
+         * @note Call on this loop's thread, e.g. from post() or a timer.
+         *       epoll_server_group::set_rebalancing() does that periodically.
+         */
+        std::size_t migrate_idle_connections(epoll_server &target, std::size_t max_count, std::chrono::milliseconds min_idle);
+
+        /**
+         * @brief Moves message handling off the loop thread
+         * @param pool Worker pool, may be shared by several loops; null handles messages on the loop again
+         *
+         * Every received chunk is then passed to on_worker_message() on
+         * the pool, through one strand per connection, instead of to
+         * on_message_received() on the loop. Replies posted with
+         * post_send() are written by the loop. When the loop stops, it
+         * waits for its messages still running on the pool.
+         *
+         * @note Call before listen()
+         * @note static_epoll_server's on_message() keeps running on the loop
+         */
+        void set_worker_pool(std::shared_ptr<worker_pool> pool) { workers = std::move(pool); }
+
+        /**
+         * @brief Get the worker pool set with set_worker_pool()
+         * @return The pool, e.g. to read its queue depth with get_stats(), or null
+         */
+        const std::shared_ptr<worker_pool> &get_worker_pool() const { return workers; }
+
+        /**
+         * @brief Get the number of this server's messages handed to the pool and not finished
+         * @return Messages queued or running on the pool; safe from any thread
+         */
+        std::size_t get_offloaded_messages() const { return offloaded.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Sets how many closed connections' state this loop keeps for reuse
+         * @param limit Retired states kept at most; 0 frees state on close
+         *
+         * A closed connection's epoll_connection (with its output queue
+         * storage) and, if the application holds no reference to it, its
+         * connection object stay in the fd's slot. The next connection
+         * accepted on that fd reinitialises them instead of allocating.
+         * A lower limit applies to connections closed from then on.
+         *
+         * @note A std::weak_ptr kept to a closed connection may observe
+         *       the reused object; hold a connection_handle instead.
+         * @note Call before listen(), or from the loop thread
+         */
+        void set_connection_pool_limit(std::size_t limit) { pool_limit = limit; }
+
+        /**
+         * @brief Get the reuse counters of the connection pool
+         * @return Counters, to be read on the loop thread or after the loop stopped
+         *
+         * After warm-up on a steady connection churn, the reused counts
+         * grow and the allocated counts stay flat.
+         */
+        const connection_pool_stats &get_connection_pool_stats() const { return pool_stats; }
+
+        /**
+         * @brief Access the pool of receive blocks used by this loop
+         * @return Reference to the pool, e.g. to read its hits()/misses() counters
+         *
+         * In steady state every receive block is recycled, so misses() stops
+         * growing; a growing miss count means slices are being retained.
+         */
+        const buffer_pool &get_recv_pool() const { return recv_pool; }
+
+        /// Identifier returned by schedule_after() and schedule_every()
+        using timer_id = uint64_t;
+
+        /**
+         * @brief Sets the idle timeout applied to connections opened afterwards
+         * @param timeout Close after this long without reads or writes (0 disables)
+         */
+        void set_idle_timeout(std::chrono::milliseconds timeout);
+
+        /**
+         * @brief Sets the read timeout applied to connections opened afterwards
+         * @param timeout Close after this long without received data (0 disables)
+         *
+         * Protects against slowloris-style clients that hold a connection open.
+         */
+        void set_read_timeout(std::chrono::milliseconds timeout);
+
+        /**
+         * @brief Sets the write timeout applied to connections opened afterwards
+         * @param timeout Abort after queued output made no progress for this long (0 disables)
+         */
+        void set_write_timeout(std::chrono::milliseconds timeout);
+
+        /**
+         * @brief Sets the output watermarks applied to connections opened afterwards
+         * @param high Queued bytes per connection that block it, 0 disables
+         * @param low Queued bytes at or below which it resumes (clamped to high)
+         *
+         * A blocked connection stops being read from (EPOLLIN is dropped), so
+         * a peer that does not read its responses cannot make the server
+         * queue unbounded output. See on_write_blocked() / on_write_drained().
+         */
+        void set_write_watermarks(std::size_t high, std::size_t low);
+
+        /**
+         * @brief Sets output watermarks over all connections of the loop
+         * @param high Total queued bytes that block every connection queueing more, 0 disables
+         * @param low Total queued bytes at or below which blocked connections resume (clamped to high)
+         */
+        void set_global_write_watermarks(std::size_t high, std::size_t low);
+
+        /**
+         * @brief Get the output queued over all connections and not yet written
+         * @return Byte count
+         */
+        std::size_t get_queued_bytes() const { return total_out_bytes; }
+
+        /**
+         * @brief Sends large writes with MSG_ZEROCOPY (Linux 4.14+)
+         * @param bytes Gathered write size from which zerocopy is used, 0 disables (default)
+         *
+         * The kernel then reads the data_buffer memory directly instead of
+         * copying it; the buffers are kept alive until its completion
+         * notification, which the loop reads from the socket error queue.
+         * Zerocopy only pays off for large writes (roughly 10KB and up)
+         * and real NICs; loopback always falls back to copying.
+         *
+         * A graceful close waits for outstanding completions; an abort
+         * resets the connection so the kernel drops the pinned pages.
+         *
+         * @note Applies to the epoll backend; io_uring_server ignores it
+         */
+        void set_zerocopy_threshold(std::size_t bytes) { zerocopy_threshold = bytes; }
+
+        /**
+         * @brief Get the MSG_ZEROCOPY counters
+         * @return Counters, to be read on the loop thread or after the loop stopped
+         */
+        const zerocopy_stats &get_zerocopy_stats() const { return zc_stats; }
+
+        /**
+         * @brief Runs a function once after a delay, on the loop thread
+         * @param delay Delay before the call
+         * @param fn Function to run
+         * @return Id usable with cancel_timer()
+         *
+         * @note Must be called from the loop thread (e.g. from a callback)
+         */
+        timer_id schedule_after(std::chrono::milliseconds delay, std::function<void()> fn);
+
+        /**
+         * @brief Runs a function periodically, on the loop thread
+         * @param period Interval between calls
+         * @param fn Function to run
+         * @return Id usable with cancel_timer()
+         *
+         * @note Must be called from the loop thread (e.g. from a callback)
+         */
+        timer_id schedule_every(std::chrono::milliseconds period, std::function<void()> fn);
+
+        /**
+         * @brief Cancels a timer created by schedule_after() or schedule_every()
+         * @param id Timer id
+         * @return true if the timer was still pending
+         *
+         * @note Must be called from the loop thread; safe from the timer's own callback
+         */
+        bool cancel_timer(timer_id id);
+
+        /**
+         * @brief Access the loop's timer wheel to arm intrusive timers
+         * @return Reference to the wheel
+         *
+         * Arming a timer object owned by the application costs no allocation.
+         * @note Must be used from the loop thread only
+         */
+        timer_wheel &get_timer_wheel() { return timers; }
     };
 }
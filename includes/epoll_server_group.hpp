@@ -0,0 +1,277 @@
+#pragma once
+
+/**
+ * @file epoll_server_group.hpp
+ * @brief Multi-reactor wrapper running one epoll_server event loop per core
+ *
+ * A single epoll_server drives every connection from one thread, so a busy
+ * server tops out at one core. epoll_server_group runs N independent
+ * epoll_server instances ("loops"), each on its own thread with its own epoll
+ * instance, connection table and SO_REUSEPORT listener bound to the same port.
+ * The kernel spreads incoming connections across the listeners, and every
+ * connection then lives on one loop, unless rebalancing is enabled: then
+ * idle connections of an overloaded loop are moved to a quieter one.
+ *
+ * Alternatively register_acceptor() binds a single listener served by a
+ * dedicated acceptor thread, which hands each accepted socket to a loop
+ * chosen round-robin or by connection count.
+ *
+ * Because each loop is an ordinary epoll_server, the same derived class and the
+ * same on_message_received/on_connection_opened overrides work unchanged; the
+ * group only needs a factory to create one instance per loop.
+ *
+ * @note register_listener() requires SO_REUSEPORT (Linux 3.9+). Not available with wepoll on Windows.
+ * @note register_acceptor() is Linux only (eventfd, poll, accept4); elsewhere it returns false.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "epoll_server.hpp"
+
+namespace hh_socket
+{
+    /**
+     * @brief When and how epoll_server_group moves idle connections between loops
+     *
+     * See epoll_server_group::set_rebalancing().
+     */
+    struct rebalance_options
+    {
+        /// How often the loops' loads are compared; 0 disables rebalancing
+        std::chrono::milliseconds interval{0};
+
+        /// Only connections without reads or writes for this long are moved
+        std::chrono::milliseconds min_idle{5000};
+
+        /// A loop is overloaded when its events per interval exceed the group average by this factor
+        double imbalance = 1.5;
+
+        /// Most connections moved per interval
+        std::size_t max_moves = 64;
+    };
+
+    /**
+     * @brief How epoll_server_group's acceptor thread picks a loop for a new connection
+     */
+    enum class acceptor_policy
+    {
+        round_robin,       ///< Loops in turn
+        least_connections, ///< Loop with the fewest open connections, counting sockets still being handed over
+    };
+
+    /**
+     * @brief Runs several epoll_server event loops sharing one listening port
+     *
+     * Every loop is created by the user-supplied factory, so each one is a
+     * separate instance of the derived server class. State kept in the derived
+     * class (for example a map of usernames) is therefore per loop; share it
+     * explicitly (and synchronize it) if the application needs a global view.
+     *
+     * Threading:
+     * - listen() runs loop 0 on the calling thread and loops 1..N-1 on
+     *   dedicated threads, then joins them once every loop has stopped.
+     * - Callbacks of a given loop are always invoked from that loop's thread,
+     *   so code that is correct for a single epoll_server stays correct.
+     *
+     * Example:
+     * @code
+     * epoll_server_group group(0, [] { return std::make_unique<EchoServer>(); });
+     * group.register_listener(8080);
+     * group.listen(1000);
+     * @endcode
+     */
+    class epoll_server_group
+    {
+    public:
+        /// Factory used to create one server instance per loop
+        using server_factory = std::function<std::unique_ptr<epoll_server>()>;
+
+    private:
+        /// One independent event loop per entry
+        std::vector<std::unique_ptr<epoll_server>> loops;
+
+        /// Threads running loops 1..N-1 while listen() is active
+        std::vector<std::thread> threads;
+
+        /// Rebalancing settings, see set_rebalancing()
+        rebalance_options balance;
+
+        /// Each loop's event counter at the previous rebalance() run
+        std::vector<uint64_t> last_events;
+
+        /// Periodic rebalance() timer on loop 0, 0 while not scheduled
+        epoll_server::timer_id balance_timer = 0;
+
+        /// Listener served by the acceptor thread, null unless register_acceptor() was called
+        std::shared_ptr<socket> acceptor_socket;
+
+        /// Loop choice of the acceptor thread
+        acceptor_policy accept_policy = acceptor_policy::round_robin;
+
+        /// Runs run_acceptor() while listen() is active
+        std::thread acceptor_thread;
+
+        /// eventfd that tells the acceptor thread to exit
+        int acceptor_stop_fd = -1;
+
+        /// Sockets handed to each loop so far; acceptor thread only
+        std::vector<uint64_t> handed;
+
+        /// Next loop for round_robin; acceptor thread only
+        std::size_t next_loop = 0;
+
+        /**
+         * @brief Body of the acceptor thread
+         *
+         * Waits on the listener and the stop eventfd, accepts until the
+         * backlog is empty and posts every socket to a loop with
+         * epoll_server::post_accepted().
+         */
+        void run_acceptor();
+
+        /**
+         * @brief Picks the loop for the next accepted socket
+         * @return Loop index
+         */
+        std::size_t pick_loop();
+
+        /// Tells the acceptor thread to exit; listen() and the destructor join it
+        void stop_acceptor();
+
+        /**
+         * @brief Compares the loops' loads and moves idle connections off the busiest one
+         *
+         * Runs on loop 0's thread every balance.interval. The loop that
+         * handled the most events since the last run is the source if it is
+         * above imbalance times the average. The loop that handled the
+         * fewest is the target. Only when the source also has more
+         * connections does up to half the difference move, capped at
+         * max_moves. The move itself runs on the source's thread.
+         */
+        void rebalance();
+
+    public:
+        /**
+         * @brief Creates the event loops
+         * @param loop_count Number of loops; 0 uses std::thread::hardware_concurrency()
+         * @param make_loop Factory returning a new server instance for each loop
+         * @throws socket_exception with type "ServerGroupCreation" if the factory returns null
+         */
+        epoll_server_group(std::size_t loop_count, const server_factory &make_loop);
+
+        // A group owns threads and servers, it cannot be copied or moved
+        epoll_server_group(const epoll_server_group &) = delete;
+        epoll_server_group &operator=(const epoll_server_group &) = delete;
+
+        /**
+         * @brief Creates one SO_REUSEPORT listener per loop and registers it
+         * @param port Port number to listen on
+         * @param ip IP address to bind to (default: "0.0.0.0")
+         * @param backlog Listen backlog of each listener (default: SOMAXCONN)
+         * @return true if every loop registered its listener, false otherwise
+         * @throws std::runtime_error if a listener socket cannot be created
+         */
+        bool register_listener(uint16_t port, const std::string &ip = "0.0.0.0", int backlog = SOMAXCONN);
+
+        /**
+         * @brief Creates one listener served by a dedicated acceptor thread
+         * @param port Port number to listen on
+         * @param ip IP address to bind to (default: "0.0.0.0")
+         * @param backlog Listen backlog (default: SOMAXCONN)
+         * @param policy How the acceptor picks the loop for each connection
+         * @return true if the acceptor was set up; false if one already was, or off Linux
+         * @throws std::runtime_error if the listener socket cannot be created
+         *
+         * Alternative to register_listener() where SO_REUSEPORT is not
+         * wanted: its hash keeps one client's connections on one loop and
+         * ignores how busy the loops are. The acceptor thread started by
+         * listen() accepts every connection and posts it to a loop's
+         * command queue; the loop then applies its ip_filter and limits and
+         * calls on_connection_opened() as usual. Each loop reports the
+         * sockets it took in loop_load::handoffs.
+         *
+         * @note Call before listen(), instead of register_listener()
+         */
+        bool register_acceptor(uint16_t port, const std::string &ip = "0.0.0.0", int backlog = SOMAXCONN,
+                               acceptor_policy policy = acceptor_policy::round_robin);
+
+        /**
+         * @brief Installs one accept filter on every loop
+         * @param filter Shared CIDR rules; replace them at runtime with filter->set_rules()
+         *
+         * @note Call before listen()
+         */
+        void set_ip_filter(const std::shared_ptr<ip_filter> &filter);
+
+        /**
+         * @brief Applies the same per-IP limits on every loop
+         * @param limits Connection cap and accept rate per remote address
+         *
+         * Each loop counts on its own, and the kernel spreads one client's
+         * connections over the loops by SO_REUSEPORT hash, so the effective
+         * group-wide limit for an address is up to size() times higher.
+         *
+         * @note Call before listen()
+         */
+        void set_ip_limits(const ip_limits &limits);
+
+        /**
+         * @brief Hands message handling of every loop to one worker pool
+         * @param pool Shared pool, see epoll_server::set_worker_pool()
+         *
+         * @note Call before listen()
+         */
+        void set_worker_pool(const std::shared_ptr<worker_pool> &pool);
+
+        /**
+         * @brief Enables periodic migration of idle connections between loops
+         * @param options Interval, idle threshold, imbalance factor and move cap; interval 0 disables
+         *
+         * SO_REUSEPORT balances connections when they are accepted, not
+         * afterwards. With long-lived connections one loop can stay busy
+         * while others idle. Rebalancing uses each loop's get_load() and
+         * epoll_server::migrate_idle_connections(); moved connections keep
+         * their pending output, and the loops get
+         * on_connection_migrated_out() / on_connection_migrated_in().
+         *
+         * @note Call before listen(). Loops running on io_uring do not take part.
+         */
+        void set_rebalancing(const rebalance_options &options);
+
+        /**
+         * @brief Runs all loops until stop_server() is called
+         * @param timeout Timeout in milliseconds used by each loop's epoll_wait
+         *
+         * Blocks the calling thread, which runs loop 0 itself. Starts the
+         * acceptor thread if register_acceptor() was called.
+         */
+        void listen(int timeout = 1000);
+
+        /**
+         * @brief Signals every loop to stop gracefully
+         */
+        void stop_server();
+
+        /**
+         * @brief Get the number of event loops
+         * @return Number of loops in the group
+         */
+        std::size_t size() const { return loops.size(); }
+
+        /**
+         * @brief Access a single event loop
+         * @param index Loop index in [0, size())
+         * @return Reference to the loop's server instance
+         */
+        epoll_server &get_loop(std::size_t index) { return *loops.at(index); }
+
+        /// Stops the acceptor and the loops and joins any thread still running
+        ~epoll_server_group();
+    };
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+/**
+ * @file epoll_server_loop.hpp
+ * @brief Event loop and read path of epoll_server, templated on the callback dispatch
+ *
+ * The loop is written once and instantiated per dispatch type:
+ * - epoll_server::virtual_dispatch (compiled into epoll_server.cpp) calls
+ *   the virtual tcp_server callbacks, which is what epoll_server::listen()
+ *   runs
+ * - static_epoll_server<Derived> instantiates it in the user's translation
+ *   unit with a dispatch that calls Derived's handlers directly, so the
+ *   per-message callback can be inlined into the read loop
+ *
+ * A Dispatch provides:
+ * - void message(epoll_connection &c, const data_buffer &db) — one received chunk
+ * - void waiting() — once per loop iteration, before epoll_wait
+ *
+ * Only include this header where the loop is instantiated.
+ */
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <errno.h>
+
+#include "epoll_server.hpp"
+
+namespace hh_socket
+{
+    /**
+     * The kernel copies straight into read_block and the callback gets a
+     * slice of it, so the bytes are never copied in user space. A slice that
+     * is queued with send_message() is written back from the same memory.
+     */
+    template <class Dispatch>
+    void epoll_server::read_stream(epoll_connection &c, Dispatch &dispatch)
+    {
+        try
+        {
+            int fd = c.conn->get_fd();
+            // Read as much data as possible (edge-triggered)
+            while (!c.want_close && !c.read_stopped && !c.write_blocked)
+            {
+                std::size_t sz = prepare_read_block();
+                auto m = ::recv(fd, &(*read_block)[read_used], sz, 0);
+                if (m > 0)
+                {
+                    data_buffer db(read_block, read_used, static_cast<std::size_t>(m));
+                    read_used += static_cast<std::size_t>(m);
+                    c.last_read = loop_time;
+                    dispatch.message(c, db);
+                }
+                else if (m == 0)
+                {
+                    // Peer closed connection gracefully
+                    close_conn(fd);
+                    return;
+                }
+                else
+                {
+                    // Error or would block
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        break; // No more data available
+                    // Connection error, close it
+                    close_conn(fd);
+                    return;
+                }
+            }
+        }
+        catch (const std::exception &e)
+        {
+            on_exception_occurred(e);
+        }
+    }
+
+    /**
+     * Event Loop Algorithm:
+     * 1. Wait for events using epoll_wait()
+     * 2. Handle timeout and error conditions
+     * 3. Auto-resize event buffer if needed
+     * 4. Process each ready event:
+     *    - New connections (listener socket)
+     *    - Incoming data (EPOLLIN)
+     *    - Socket ready for writing (EPOLLOUT)
+     *    - Connection errors/closures
+     * 5. Repeat until stop signal
+     *
+     * Performance Features:
+     * - Edge-triggered epoll for minimal syscalls
+     * - Batch event processing
+     * - Non-blocking accept loop for connection bursts
+     * - Intelligent write flow control
+     * - Dynamic event buffer sizing
+     *
+     * Error Handling:
+     * - Graceful degradation on individual connection errors
+     * - Exception isolation prevents server crashes
+     * - Automatic cleanup of failed connections
+     */
+    template <class Dispatch>
+    void epoll_server::run_loop(Dispatch &dispatch, int timeout)
+    {
+        on_listen_success();
+        while (!g_stop)
+            try
+            {
+                dispatch.waiting();
+
+                // Write out everything queued by callbacks since the last wait
+                flush_pending_writes();
+
+                // Wait for events, but no longer than until the next timer is due
+                int n = epoll_wait(epoll_fd, events.data(), (int)events.size(), timers.next_timeout(timeout));
+                loop_time = timer_wheel::clock_ms();
+                if (n > 0)
+                    bump(load_events, static_cast<uint64_t>(n));
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue; // Interrupted by signal, continue
+                    // Fatal error in epoll_wait
+                    on_exception_occurred(std::runtime_error("epoll_wait failed: " + std::string(strerror(errno))));
+                    break;
+                }
+
+                // Auto-resize event buffer if saturated (indicates high load)
+                if (n == (int)events.size())
+                {
+                    // grow event buffer if saturated
+                    events.resize(events.size() * 2);
+                }
+                // Process each ready event
+                for (int i = 0; i < n; ++i)
+                {
+                    uint32_t ev = events[i].events;
+                    uint64_t token = events[i].data.u64;
+                    int fd = event_token_fd(token);
+
+                    // Commands posted from other threads
+                    if (fd == wake_fd)
+                    {
+                        drain_commands();
+                        continue;
+                    }
+
+                    // Handle new connections on listener socket
+                    if (listener_socket && fd == listener_socket->get_fd())
+                    {
+                        try_accept();
+                        continue;
+                    }
+
+                    // Find connection state; a generation mismatch means the fd was
+                    // closed earlier in this batch and reused by a new connection
+                    epoll_connection *found = conns.find(fd, event_token_gen(token));
+                    if (!found)
+                    {
+                        // Not a connection: a UDP endpoint, or a connection closed or replaced
+                        if (udp_endpoint *u = udp_endpoints.find(fd))
+                        {
+                            if ((ev & EPOLLOUT) && !u->outq.empty())
+                                flush_datagrams(*u);
+                            if (ev & (EPOLLIN | EPOLLERR))
+                                try_read_datagrams(*u);
+                        }
+                        continue;
+                    }
+                    epoll_connection &c = *found;
+
+                    // EPOLLERR also signals MSG_ZEROCOPY completions on the error queue
+                    bool failed = ev & (EPOLLERR | EPOLLHUP);
+                    if ((ev & EPOLLERR) && c.zerocopy > 0)
+                        failed = !drain_zerocopy(c) || (ev & EPOLLHUP);
+
+                    // Socket writable, or data queued since the last event: flush the queue
+                    if (c.has_output() || c.want_write)
+                        flush_and_update_interest(c);
+
+                    // Handle connection errors and closures
+                    if (failed)
+                    {
+                        close_conn(fd);
+                        continue;
+                    }
+
+                    // Close requested by the application, once pending output is flushed
+                    if (c.want_close)
+                    {
+                        if (c.ready_to_close())
+                            close_conn(fd);
+                        continue;
+                    }
+
+                    // Handle incoming data (EPOLLIN)
+                    if ((ev & EPOLLIN) && !c.read_stopped)
+                    {
+                        read_stream(c, dispatch);
+                    }
+                }
+                // After processing all events, you try to accept the connections that failed
+                if (listener_socket)
+                    try_accept();
+
+                // Fire expired connection deadlines and user timers
+                run_timers();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "UNKNOWN ERROR CAUGHT BY EVENT LOOP: " << e.what() << std::endl;
+                on_exception_occurred(e);
+            }
+
+        // on_worker_message() calls still running use this object
+        wait_offloaded();
+        on_shutdown_success();
+    }
+}
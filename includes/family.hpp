@@ -28,9 +28,6 @@ namespace hh_socket
     class family
     {
     private:
-        /// Allowed address family values (IPv4 and IPv6)
-        std::vector<int> allowed_families = {IPV4, IPV6};
-
         /// Current address family ID
         int family_id;
 
@@ -41,7 +38,8 @@ namespace hh_socket
          */
         void set_family_id(int id)
         {
-            if (std::find(allowed_families.begin(), allowed_families.end(), id) != allowed_families.end())
+            // Allowed address family values (IPv4 and IPv6); checked without a container so a family never allocates
+            if (id == IPV4 || id == IPV6)
             {
                 family_id = id;
             }
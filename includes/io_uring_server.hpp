@@ -0,0 +1,147 @@
+#pragma once
+
+/**
+ * @file io_uring_server.hpp
+ * @brief io_uring backend for the TCP server, with runtime fallback to epoll
+ *
+ * io_uring_server runs the same connection state and callbacks as
+ * epoll_server, but drives I/O through an io_uring submission queue instead of
+ * epoll_wait + recv/send. One io_uring_enter() call submits every queued
+ * operation and reaps every completion, so the number of syscalls no longer
+ * grows with the number of readiness events.
+ *
+ * Operations used:
+ * - Multishot accept on the listening socket (one SQE accepts many clients)
+ * - Multishot recv per connection with a provided buffer ring, so no buffer
+ *   is pinned per idle connection
+ * - Gathered sendmsg for the output queue; queues longer than IOV_MAX are
+ *   submitted as a chain of linked SQEs that the kernel executes in order
+ *
+ * Build / runtime:
+ * - Compiled only when the IO_URING CMake option is ON (defines
+ *   HH_SOCKET_IO_URING) on Linux. Otherwise the class still exists and
+ *   always runs the epoll loop, so application code does not need #ifdefs.
+ * - If the running kernel lacks io_uring or one of the features above
+ *   (Linux 6.0+), listen() transparently falls back to epoll_server::listen().
+ */
+
+#include <atomic>
+#include <memory>
+
+#include "epoll_server.hpp"
+
+namespace hh_socket
+{
+    /**
+     * @brief TCP server driven by io_uring, falling back to epoll when unavailable
+     *
+     * Derive from io_uring_server exactly as from epoll_server; the callbacks,
+     * send_message() and close_connection() behave the same on both backends.
+     *
+     * @note Not yet covered on the io_uring path: stop_reading_from_connection()
+     *       only prevents re-arming the multishot recv, so data already in
+     *       flight is still delivered.
+     */
+    class io_uring_server : public epoll_server
+    {
+    private:
+        /// Ring, provided buffers and per-fd bookkeeping (Linux only)
+        struct ring_state;
+
+        /// Owned ring state, created by listen() on the loop thread
+        std::unique_ptr<ring_state> ring;
+
+        /// Requested submission queue size
+        unsigned ring_entries;
+
+        /// Number of provided receive buffers (rounded up to a power of two)
+        unsigned recv_buffer_count;
+
+        /// Size of each provided receive buffer in bytes
+        unsigned recv_buffer_size;
+
+        /// Set while the loop runs on io_uring rather than the epoll fallback; read by other loops
+        std::atomic<bool> using_ring{false};
+
+        /**
+         * @brief Creates the ring and registers the provided buffer ring
+         * @return true if io_uring with all required features is available
+         */
+        bool setup_ring();
+
+        /**
+         * @brief Main io_uring event loop
+         * @param timeout Timeout in milliseconds for each wait (-1 for blocking)
+         */
+        void uring_loop(int timeout);
+
+        /**
+         * @brief Submits send chains and deferred closes for pending connections
+         *
+         * io_uring counterpart of epoll_server::flush_pending_writes().
+         */
+        void uring_flush_pending();
+
+        /**
+         * @brief Queues the output of one connection as a chain of linked sendmsg SQEs
+         * @param c Connection whose outq should be written
+         */
+        void submit_send(epoll_connection &c);
+
+        /**
+         * @brief Pauses or resumes reading of a write-blocked connection
+         * @param c Connection with write_blocked set
+         *
+         * Cancels the multishot recv while the connection stays blocked;
+         * re-arms it and calls on_write_drained() once it can resume.
+         */
+        void update_write_block(epoll_connection &c);
+
+        /**
+         * @brief Closes a connection and terminates its in-flight operations
+         * @param fd File descriptor of the connection
+         */
+        void uring_close(int fd);
+
+        /**
+         * @brief Admits and opens an accepted socket, then arms its multishot recv
+         * @param cfd Accepted client file descriptor
+         * @param client_addr Remote address
+         *
+         * Falls back to epoll_server::accept_conn() on the epoll loop.
+         */
+        void accept_conn(socket_t cfd, sockaddr_storage &client_addr) override;
+
+        /**
+         * @brief Check whether connections can move to or from this loop
+         * @return false while running on io_uring: recvs and send chains in flight are bound to the ring
+         */
+        bool supports_migration() const override { return !using_ring; }
+
+    public:
+        /**
+         * @brief Constructs the server
+         * @param max_fds Maximum number of file descriptors (see epoll_server)
+         * @param ring_entries Submission queue size (default: 4096)
+         * @param recv_buffer_count Number of provided receive buffers (default: 1024)
+         * @param recv_buffer_size Size of each receive buffer in bytes (default: 16KB)
+         */
+        io_uring_server(int max_fds, unsigned ring_entries = 4096,
+                        unsigned recv_buffer_count = 1024, unsigned recv_buffer_size = 16 * 1024);
+
+        /**
+         * @brief Check whether the last listen() ran on io_uring
+         * @return true if io_uring was used, false if the epoll fallback ran
+         */
+        bool is_using_io_uring() const;
+
+        /**
+         * @brief Starts the event loop, on io_uring if available, otherwise epoll
+         * @param timeout Timeout in milliseconds for each wait
+         */
+        void listen(int timeout) override;
+
+        /// Releases the ring and its buffers
+        ~io_uring_server() override;
+    };
+}
@@ -1,41 +1,54 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <string>
 #include <ostream>
+#include <type_traits>
+
+#include "utilities.hpp"
 
 namespace hh_socket
 {
     /**
      * @brief Represents an IP address (IPv4 or IPv6) for network operations.
      *
-     * This class provides a type-safe wrapper around IP address strings, offering
-     * validation and convenient comparison operations. It can handle both IPv4
-     * addresses (e.g., "192.168.1.1") and IPv6 addresses (e.g., "::1", "2001:db8::1").
+     * The address is stored in binary form: the 4 (IPv4) or 16 (IPv6) bytes in
+     * network order, plus their count. The class is trivially copyable and never
+     * allocates; the textual form is only produced when get() or operator<< is
+     * called. This makes it cheap to build one per accepted connection and to use
+     * as a key for per-IP bookkeeping (std::hash is provided).
      *
-     * The class stores the IP address as a string representation, which is
-     * platform-independent and suitable for both display and network operations.
-     * It provides standard comparison operators for use in containers and sorting.
+     * Text is parsed and formatted by the class itself rather than by
+     * inet_pton()/inet_ntop(): the parser only accepts what inet_pton() accepts
+     * (dotted-quad IPv4 without leading zeros, IPv6 with at most one "::" and an
+     * optional dotted-quad tail) and the formatter produces the RFC 5952 form.
      *
      * @note Uses explicit constructors to prevent implicit conversions for type safety.
-     * @note The class does not perform validation of IP address format - it stores
-     *       whatever string is provided. Validation should be performed by the caller
-     *       or higher-level network classes.
-     *
-     * @endcode
+     * @note A string that is not a valid IPv4 or IPv6 literal yields an empty
+     *       address (empty() returns true); the constructor does not throw.
+     * @note Ordering is numeric: empty addresses first, then IPv4, then IPv6,
+     *       each by value.
      */
     class ip_address
     {
     private:
-        /// String representation of the IP address
-        std::string address;
+        /// Address bytes in network order, zero past `length`
+        std::uint8_t octets[16] = {};
+
+        /// 4 for IPv4, 16 for IPv6, 0 for an empty address
+        std::uint8_t length = 0;
 
     public:
+        /// Longest text get() can produce, including the terminating NUL (INET6_ADDRSTRLEN)
+        static constexpr std::size_t MAX_TEXT_LENGTH = 46;
+
         /**
          * @brief Default constructor - creates an empty IP address.
          *
-         * Creates an ip_address object with an empty string. This is useful for
-         * creating objects that will be assigned values later or for representing
-         * an unspecified address.
+         * Useful for objects that will be assigned values later or for
+         * representing an unspecified address.
          *
          * Marked explicit to prevent implicit conversions.
          */
@@ -45,48 +58,127 @@ namespace hh_socket
          * @brief Construct IP address from string representation.
          * @param address String containing the IP address
          *
-         * Creates an ip_address object from a string representation of an IP address.
-         * The string can contain IPv4 addresses (dotted decimal notation) or IPv6
-         * addresses (colon-hexadecimal notation).
+         * Parses IPv4 addresses (dotted decimal notation) or IPv6 addresses
+         * (colon-hexadecimal notation) into binary form.
          *
-         * @note This constructor does not validate the IP address format.
-         *       Invalid strings will be stored as-is, which may cause issues
-         *       in network operations.
+         * @note Invalid strings produce an empty address, see parse() to detect them.
          */
-        explicit ip_address(const std::string &address) : address(address) {}
+        explicit ip_address(const std::string &address) { parse(address.data(), address.size(), *this); }
 
-        // Copy operations - Safe and efficient for string-based class
+        // Copy and move operations - plain memory copies
         ip_address(const ip_address &) = default;
         ip_address &operator=(const ip_address &) = default;
-
-        // Move operations - Efficient for string transfer
         ip_address(ip_address &&) = default;
         ip_address &operator=(ip_address &&) = default;
 
+        /**
+         * @brief Parse an IPv4 or IPv6 literal.
+         * @param text Characters to parse (need not be NUL-terminated)
+         * @param len Number of characters
+         * @param out Receives the address on success, left untouched otherwise
+         * @return true if the whole text is a valid address
+         */
+        static bool parse(const char *text, std::size_t len, ip_address &out);
+
+        /**
+         * @brief Build an address from raw network-order bytes.
+         * @param bytes 4 bytes (in_addr) or 16 bytes (in6_addr)
+         * @param len 4 or 16; any other value gives an empty address
+         */
+        static ip_address from_bytes(const void *bytes, std::size_t len);
+
+        /**
+         * @brief Extract the address of a sockaddr_in or sockaddr_in6.
+         * @param addr System address, e.g. filled by accept() or recvfrom()
+         * @return The address, empty for other families
+         */
+        static ip_address from_sockaddr(const sockaddr_storage &addr);
+
         /**
          * @brief Get the IP address string.
-         * @return Const reference to the IP address string
+         * @return Textual form of the address, empty for an empty address
+         *
+         * Formats the binary address on each call.
+         */
+        std::string get() const;
+
+        /**
+         * @brief Format the address into a caller-provided buffer.
+         * @param out Buffer of at least MAX_TEXT_LENGTH bytes
+         * @return Number of characters written, not counting the terminating NUL
+         */
+        std::size_t format(char *out) const;
+
+        /// True if no address is held (default-constructed or parse failure)
+        bool empty() const { return length == 0; }
+
+        /// True for a 4-byte IPv4 address
+        bool is_ipv4() const { return length == 4; }
+
+        /// True for a 16-byte IPv6 address (including IPv4-mapped ones)
+        bool is_ipv6() const { return length == 16; }
+
+        /// True for an IPv6 address of the form ::ffff:a.b.c.d
+        bool is_v4_mapped() const;
+
+        /**
+         * @brief Returns the embedded IPv4 address of an IPv4-mapped IPv6 address.
+         * @return The IPv4 address, or a copy of *this if it is not mapped
          *
-         * Returns a const reference to the internal string representation
-         * of the IP address. This avoids copying and allows efficient
-         * access to the address value.
+         * Dual-stack listeners report IPv4 peers as ::ffff:a.b.c.d; unmapping
+         * lets them match IPv4 rules and share per-IP state with plain IPv4.
          */
-        const std::string &get() const { return address; }
+        ip_address unmapped() const;
+
+        /// Address bytes in network order (size() of them)
+        const std::uint8_t *data() const { return octets; }
+
+        /// Number of address bytes: 4, 16, or 0 when empty
+        std::size_t size() const { return length; }
+
+        /**
+         * @brief CIDR containment test.
+         * @param network Network address, e.g. 10.0.0.0
+         * @param prefix_length Number of leading bits that must match, e.g. 8
+         * @return true if this address lies in network/prefix_length
+         *
+         * Families must match, except that an IPv4-mapped IPv6 address is
+         * tested as IPv4 against an IPv4 network. A prefix longer than the
+         * address is clamped to the full address; a negative one matches
+         * nothing.
+         */
+        bool in_subnet(const ip_address &network, int prefix_length) const;
+
+        /// Hash of the binary address, as used by std::hash<ip_address>
+        std::size_t hash() const
+        {
+            std::uint64_t lo, hi;
+            std::memcpy(&lo, octets, sizeof(lo));
+            std::memcpy(&hi, octets + 8, sizeof(hi));
+            std::uint64_t h = (lo ^ (hi * 0x9e3779b97f4a7c15ULL)) + length;
+            // Final mix of MurmurHash3 (fmix64)
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return static_cast<std::size_t>(h);
+        }
 
         /**
          * @brief Equality comparison operator.
          * @param other IP address object to compare with
-         * @return true if both objects contain the same IP address string
+         * @return true if both hold the same family and bytes
          */
         bool operator==(const ip_address &other) const
         {
-            return address == other.address;
+            return length == other.length && std::memcmp(octets, other.octets, sizeof(octets)) == 0;
         }
 
         /**
          * @brief Inequality comparison operator.
          * @param other IP address object to compare with
-         * @return true if objects contain different IP address strings
+         * @return true if objects hold different addresses
          */
         bool operator!=(const ip_address &other) const
         {
@@ -96,11 +188,16 @@ namespace hh_socket
         /**
          * @brief Less-than comparison operator for ordering.
          * @param other IP address object to compare with
-         * @return true if this address string is lexicographically less than other's
+         * @return true if this address is numerically less than other's
+         *
+         * Shorter families sort first (empty, IPv4, IPv6); within a family
+         * the network-order bytes compare as one big-endian number.
          */
         bool operator<(const ip_address &other) const
         {
-            return address < other.address;
+            if (length != other.length)
+                return length < other.length;
+            return std::memcmp(octets, other.octets, length) < 0;
         }
 
         /**
@@ -111,11 +208,27 @@ namespace hh_socket
          */
         friend std::ostream &operator<<(std::ostream &os, const ip_address &ip)
         {
-            os << ip.address;
+            char text[MAX_TEXT_LENGTH];
+            os.write(text, static_cast<std::streamsize>(ip.format(text)));
             return os;
         }
 
         /// Default destructor
         ~ip_address() = default;
     };
-}
\ No newline at end of file
+
+    static_assert(std::is_trivially_copyable<ip_address>::value,
+                  "ip_address must stay a plain memory copy");
+}
+
+namespace std
+{
+    template <>
+    struct hash<hh_socket::ip_address>
+    {
+        std::size_t operator()(const hh_socket::ip_address &address) const noexcept
+        {
+            return address.hash();
+        }
+    };
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+/**
+ * @file ip_filter.hpp
+ * @brief CIDR allow/deny rules evaluated on accepted connections
+ *
+ * An epoll_server with an ip_filter checks the peer address of every
+ * accepted socket right after accept4(). A denied peer is closed before a
+ * connection object is created and before on_connection_opened() runs, so
+ * blocked networks cost one accept4() and one close().
+ *
+ * Rules live in an immutable ip_filter_rules object. An ip_filter publishes
+ * the current rule set; replacing it at runtime is an atomic swap that the
+ * loops pick up on their next accept without any lock on the accept path.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ip_address.hpp"
+
+namespace hh_socket
+{
+    /**
+     * @brief What to do with a peer matched by a rule
+     */
+    enum class ip_filter_action
+    {
+        allow, ///< Accept the connection
+        deny,  ///< Close the connection right after accept
+    };
+
+    /**
+     * @brief One CIDR rule of an ip_filter_rules set
+     */
+    struct ip_filter_rule
+    {
+        /// Network address (bits past prefix_length are ignored)
+        ip_address network;
+
+        /// Number of leading bits that must match
+        int prefix_length = 0;
+
+        /// Action applied to matching peers
+        ip_filter_action action = ip_filter_action::deny;
+    };
+
+    /**
+     * @brief A set of IPv4/IPv6 CIDR rules with longest-prefix matching
+     *
+     * The most specific matching rule decides, so a /32 allow inside a /8
+     * deny lets that one host through. Peers matching no rule get the
+     * default action. IPv4-mapped IPv6 peers (::ffff:a.b.c.d, as reported
+     * by dual-stack listeners) are matched against the IPv4 rules.
+     *
+     * Rules are compiled into one trie per family with 4-bit strides
+     * (16 children per node). Prefixes that are not a multiple of 4 bits
+     * are expanded into the slots they cover, so a lookup reads at most one
+     * node per 4 address bits (8 for IPv4) and stops at the first slot
+     * without children.
+     *
+     * Threading:
+     * - add() must not run concurrently with anything else; build the set,
+     *   then publish it with ip_filter::set_rules()
+     * - evaluate() may then run on any number of threads
+     * - Hit counters are relaxed atomics, readable from any thread
+     */
+    class ip_filter_rules
+    {
+    private:
+        /// Trie slot: a child node, a rule, both or neither
+        struct slot
+        {
+            /// Index of the child node, 0 for none (the root is never a child)
+            uint32_t child = 0;
+
+            /// Index of the rule stored here, -1 for none
+            int32_t rule = -1;
+
+            /// Prefix length of that rule, decides which of two expanded rules wins
+            int32_t rule_prefix = -1;
+        };
+
+        /// Trie node: one slot per 4-bit value
+        struct node
+        {
+            slot slots[16];
+        };
+
+        /// Rules in the order they were added
+        std::vector<ip_filter_rule> rules;
+
+        /// Trie of IPv4 rules, node 0 is the root
+        std::vector<node> v4_nodes;
+
+        /// Trie of IPv6 rules, node 0 is the root
+        std::vector<node> v6_nodes;
+
+        /// Rule matching every IPv4 address (/0), -1 for none
+        int32_t v4_default_rule = -1;
+
+        /// Rule matching every IPv6 address (/0), -1 for none
+        int32_t v6_default_rule = -1;
+
+        /// Action for peers matching no rule
+        ip_filter_action default_action;
+
+        /// Hits per rule (deque: atomics cannot move when more rules are added)
+        mutable std::deque<std::atomic<uint64_t>> hit_counts;
+
+        /// Peers that matched no rule
+        mutable std::atomic<uint64_t> default_hit_count{0};
+
+        /// Stores a rule in the trie of its family
+        void insert(int32_t rule_index);
+
+    public:
+        /**
+         * @brief Creates an empty rule set
+         * @param default_action Action for peers matching no rule (default: allow)
+         */
+        explicit ip_filter_rules(ip_filter_action default_action = ip_filter_action::allow);
+
+        // Holds atomics and is shared by pointer, it cannot be copied or moved
+        ip_filter_rules(const ip_filter_rules &) = delete;
+        ip_filter_rules &operator=(const ip_filter_rules &) = delete;
+
+        /**
+         * @brief Adds a rule
+         * @param network Network address; IPv4 or IPv6
+         * @param prefix_length Leading bits to match, clamped to the address size
+         * @param action Action for matching peers
+         * @return Index of the rule, for hits()
+         * @throws socket_exception with type "InvalidCidr" if network is empty or prefix_length is negative
+         *
+         * A rule with the same network and prefix as an earlier one replaces
+         * it in the trie; both keep their own counters.
+         */
+        std::size_t add(const ip_address &network, int prefix_length, ip_filter_action action);
+
+        /**
+         * @brief Adds a rule written in CIDR notation
+         * @param cidr "10.0.0.0/8", "2001:db8::/32", or a single address ("192.0.2.7")
+         * @param action Action for matching peers
+         * @return Index of the rule, for hits()
+         * @throws socket_exception with type "InvalidCidr" if the text cannot be parsed
+         */
+        std::size_t add(const std::string &cidr, ip_filter_action action);
+
+        /**
+         * @brief Finds the most specific rule matching an address
+         * @param address Peer address
+         * @return Rule index, or -1 if no rule matches
+         *
+         * Does not count a hit.
+         */
+        int match(const ip_address &address) const;
+
+        /**
+         * @brief Decides whether a peer is allowed and counts the hit
+         * @param address Peer address
+         * @return Action of the matching rule, or the default action
+         */
+        ip_filter_action evaluate(const ip_address &address) const;
+
+        /// Number of rules
+        std::size_t size() const { return rules.size(); }
+
+        /// Rule by index
+        const ip_filter_rule &get_rule(std::size_t index) const { return rules.at(index); }
+
+        /// Action for peers matching no rule
+        ip_filter_action get_default_action() const { return default_action; }
+
+        /// Peers decided by a rule, by rule index
+        uint64_t hits(std::size_t index) const { return hit_counts.at(index).load(std::memory_order_relaxed); }
+
+        /// Peers that matched no rule
+        uint64_t default_hits() const { return default_hit_count.load(std::memory_order_relaxed); }
+    };
+
+    /**
+     * @brief Publishes the current ip_filter_rules to any number of event loops
+     *
+     * One filter is typically shared by every loop of an epoll_server_group.
+     * set_rules() swaps the rule set while the loops are running. Each loop
+     * keeps its own reference to the set it is using and compares a version
+     * number on every accept: the accept path is one atomic load, and only
+     * a loop that sees a new version takes the (briefly locked) shared_ptr
+     * load. A replaced set is freed once the last loop moved past it.
+     */
+    class ip_filter
+    {
+    private:
+        /// Current rule set; read and written with std::atomic_load/std::atomic_store
+        std::shared_ptr<const ip_filter_rules> rules;
+
+        /// Bumped after every set_rules()
+        std::atomic<uint64_t> version{0};
+
+    public:
+        /**
+         * @brief Creates a filter
+         * @param initial Rule set to start with; null allows everyone
+         */
+        explicit ip_filter(std::shared_ptr<const ip_filter_rules> initial = nullptr);
+
+        ip_filter(const ip_filter &) = delete;
+        ip_filter &operator=(const ip_filter &) = delete;
+
+        /**
+         * @brief Replaces the rule set, from any thread
+         * @param next New rule set; null allows everyone
+         *
+         * Connections accepted before a loop notices the swap are not
+         * re-checked.
+         */
+        void set_rules(std::shared_ptr<const ip_filter_rules> next);
+
+        /// Current rule set (may be null), from any thread
+        std::shared_ptr<const ip_filter_rules> get_rules() const;
+
+        /// Number of set_rules() calls so far
+        uint64_t get_version() const { return version.load(std::memory_order_acquire); }
+    };
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+/**
+ * @file ip_limiter.hpp
+ * @brief Per-source-IP connection caps and accept rate limits
+ *
+ * During a connection flood a server that accepts everything runs into the
+ * fd limit, and from then on legitimate clients cannot get in. ip_limiter
+ * keeps, per remote address, the number of open connections and a token
+ * bucket of accepts. epoll_server consults it right after accept4() and
+ * closes over-limit sockets before creating any connection state.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "ip_address.hpp"
+
+namespace hh_socket
+{
+    /**
+     * @brief Per-IP limits applied by epoll_server::set_ip_limits(); 0 disables a limit
+     */
+    struct ip_limits
+    {
+        /// Open connections allowed per remote address
+        uint32_t max_connections_per_ip = 0;
+
+        /// Sustained accepts per second allowed per remote address
+        double accepts_per_second = 0;
+
+        /// Accepts a remote address may make in a burst; values below 1 use max(1, accepts_per_second)
+        double accept_burst = 0;
+
+        /// Close over-limit sockets with a reset (SO_LINGER 0) instead of a FIN
+        bool reset_over_limit = false;
+    };
+
+    /**
+     * @brief Counters of an ip_limiter
+     */
+    struct ip_limit_stats
+    {
+        /// Sockets refused because their address had max_connections_per_ip open
+        uint64_t over_connections = 0;
+
+        /// Sockets refused because their address ran out of accept tokens
+        uint64_t over_rate = 0;
+    };
+
+    /**
+     * @brief Tracks open connections and accept tokens per remote address
+     *
+     * State lives in a flat open-addressing hash table (linear probing)
+     * keyed on the binary address, 32 bytes per entry and no allocation
+     * per lookup. IPv4-mapped IPv6 addresses count as their IPv4 address.
+     *
+     * Entries of addresses with no open connection and a full bucket carry
+     * no information; they are purged when the table fills up, before it is
+     * grown, so a flood from many addresses does not grow it for good.
+     *
+     * @note Not thread-safe; every event loop owns its own limiter, so limits
+     *       apply per loop.
+     */
+    class ip_limiter
+    {
+    private:
+        /// State of one remote address
+        struct entry
+        {
+            /// Remote address, empty for a free slot
+            ip_address address;
+
+            /// Connections counted by admit() and not yet released
+            uint32_t connections = 0;
+
+            /// Accept tokens left at last_refill
+            float tokens = 0;
+
+            /// Clock (ms, truncated to 32 bits) at which tokens was computed
+            uint32_t last_refill = 0;
+        };
+
+        /// Hash table, size is a power of two
+        std::vector<entry> table;
+
+        /// Used slots
+        std::size_t used = 0;
+
+        /// Limits in force
+        ip_limits limits;
+
+        /// Refusal counters
+        ip_limit_stats stats;
+
+        /// Bucket size derived from limits
+        float burst() const;
+
+        /// Tokens of an entry at now_ms
+        float tokens_at(const entry &e, uint32_t now_ms) const;
+
+        /// Slot holding address, or the free slot where it would go
+        std::size_t probe(const ip_address &address) const;
+
+        /// Rebuilds the table without idle entries, growing it if still half full
+        void compact(uint32_t now_ms);
+
+        /// Entry of peer, created with a full bucket if there is none
+        entry &find_or_insert(const ip_address &peer, uint32_t now_ms);
+
+    public:
+        /// Creates a limiter with no limits
+        ip_limiter();
+
+        /**
+         * @brief Replaces the limits
+         * @param next New limits
+         *
+         * Open connections stay counted, so lowering the cap does not close
+         * anything but refuses new connections until enough have closed.
+         */
+        void set_limits(const ip_limits &next) { limits = next; }
+
+        /// Limits in force
+        const ip_limits &get_limits() const { return limits; }
+
+        /// True if a connection cap or an accept rate is set
+        bool active() const { return limits.max_connections_per_ip > 0 || limits.accepts_per_second > 0; }
+
+        /**
+         * @brief Decides whether a freshly accepted connection may stay open
+         * @param address Remote address
+         * @param now_ms Current loop time in ms
+         * @return true if it is within the limits; it is then counted until release()
+         *
+         * Always true (and nothing counted) when no limit is active.
+         */
+        bool admit(const ip_address &address, uint64_t now_ms);
+
+        /**
+         * @brief Uncounts a connection admitted earlier
+         * @param address Remote address passed to admit()
+         */
+        void release(const ip_address &address);
+
+        /**
+         * @brief Counts a connection that was admitted elsewhere
+         * @param address Remote address
+         * @param now_ms Current clock in ms, only used if the table is compacted
+         *
+         * Used for connections migrated from another loop: the cap sees
+         * them, but no accept token is taken and nothing is refused.
+         * Does nothing when no limit is active.
+         */
+        void track(const ip_address &address, uint64_t now_ms);
+
+        /**
+         * @brief Get the open connections counted for an address
+         * @param address Remote address
+         * @return Number of admitted, not yet released connections
+         */
+        uint32_t connections(const ip_address &address) const;
+
+        /// Number of addresses currently tracked
+        std::size_t size() const { return used; }
+
+        /// Refusal counters
+        const ip_limit_stats &get_stats() const { return stats; }
+    };
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+/**
+ * @file mpsc_queue.hpp
+ * @brief Lock-free multi-producer single-consumer queue
+ *
+ * Used to hand work to an event loop from other threads. Producers never
+ * block each other or the consumer: a push is one allocation, one atomic
+ * exchange and one store. The consumer pops without atomic read-modify-write
+ * operations.
+ *
+ * Algorithm (Vyukov's non-intrusive MPSC queue):
+ * - The queue is a singly linked list from tail (oldest) to head (newest).
+ *   tail always points at a dummy node whose value was already consumed.
+ * - push() swaps head to the new node, then links the previous head to it.
+ *   Between those two steps the list is briefly cut: the consumer sees the
+ *   queue as empty from that point on until the producer finishes linking.
+ * - pop() advances tail to tail->next, moves the value out and frees the
+ *   old dummy.
+ */
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace hh_socket
+{
+    /**
+     * @brief Unbounded lock-free queue with many producers and one consumer
+     *
+     * @tparam T Element type, must be move-constructible
+     *
+     * @note push() may be called from any thread; pop() and empty() only
+     *       from the single consumer thread.
+     */
+    template <typename T>
+    class mpsc_queue
+    {
+    private:
+        struct node
+        {
+            std::atomic<node *> next{nullptr};
+            std::optional<T> value;
+        };
+
+        /// Newest node, swapped by producers; on its own cache line
+        alignas(64) std::atomic<node *> head;
+
+        /// Dummy node before the oldest element, owned by the consumer
+        alignas(64) node *tail;
+
+    public:
+        mpsc_queue()
+        {
+            node *stub = new node();
+            head.store(stub, std::memory_order_relaxed);
+            tail = stub;
+        }
+
+        mpsc_queue(const mpsc_queue &) = delete;
+        mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+        /// Destroys the elements still queued; no producer may run concurrently
+        ~mpsc_queue()
+        {
+            while (node *n = tail)
+            {
+                tail = n->next.load(std::memory_order_relaxed);
+                delete n;
+            }
+        }
+
+        /**
+         * @brief Appends an element
+         * @param value Element to move into the queue
+         *
+         * Wait-free apart from the node allocation.
+         */
+        void push(T value)
+        {
+            node *n = new node();
+            n->value.emplace(std::move(value));
+            node *prev = head.exchange(n, std::memory_order_acq_rel);
+            prev->next.store(n, std::memory_order_release);
+        }
+
+        /**
+         * @brief Removes the oldest element
+         * @param out Receives the element
+         * @return true if an element was popped, false if the queue looked empty
+         *
+         * May report empty while a push() is half done; that producer's
+         * element (and any pushed after it) becomes visible once it finishes.
+         */
+        bool pop(T &out)
+        {
+            node *next = tail->next.load(std::memory_order_acquire);
+            if (!next)
+                return false;
+            out = std::move(*next->value);
+            next->value.reset();
+            delete tail;
+            tail = next;
+            return true;
+        }
+
+        /**
+         * @brief Check whether the consumer would find an element
+         * @return true if pop() would currently return false
+         */
+        bool empty() const { return tail->next.load(std::memory_order_acquire) == nullptr; }
+    };
+}
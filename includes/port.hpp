@@ -19,8 +19,8 @@ namespace hh_socket
     class port
     {
     private:
-        /// Port number (0-65535)
-        int port_id;
+        /// Port number (0-65535), 0 until set
+        int port_id = 0;
 
         /**
          * @brief Validates and sets the port ID.
@@ -38,10 +38,9 @@ namespace hh_socket
 
     public:
         /**
-         * @brief Default constructor - creates uninitialized port.
+         * @brief Default constructor - creates an unset port (0).
          *
-         * Creates a port object with undefined value. Must be assigned
-         * a valid port number before use.
+         * Must be assigned a valid port number before use.
          */
         explicit port() = default;
 
@@ -14,6 +14,7 @@
 #include "socket_address.hpp"
 #include "file_descriptor.hpp"
 #include "data_buffer.hpp"
+#include "datagram_batch.hpp"
 #include "utilities.hpp"
 #include "exceptions.hpp"
 #include "connection.hpp"
@@ -55,6 +56,9 @@ namespace hh_socket
         /// flag to indicate if the socket is open
         bool is_open{true};
 
+        /// Set once the kernel rejected UDP_SEGMENT; send_segments() then sends one datagram per syscall
+        bool gso_rejected{false};
+
     public:
         /// Default constructor deleted - sockets must be explicitly configured
         socket() = delete;
@@ -87,7 +91,7 @@ namespace hh_socket
          * Transfers ownership of socket resources. Source socket becomes invalid.
          */
         socket(socket &&other)
-            : addr(std::move(other.addr)), fd(std::move(other.fd)), protocol(other.protocol) {}
+            : addr(std::move(other.addr)), fd(std::move(other.fd)), protocol(other.protocol), gso_rejected(other.gso_rejected) {}
 
         /**
          * @brief Move assignment operator.
@@ -103,6 +107,7 @@ namespace hh_socket
                 addr = std::move(other.addr);
                 fd = std::move(other.fd);
                 protocol = other.protocol;
+                gso_rejected = other.gso_rejected;
             }
             return *this;
         }
@@ -121,6 +126,18 @@ namespace hh_socket
          */
         void set_reuse_address(bool reuse);
 
+        /**
+         * @brief Sets SO_REUSEPORT socket option.
+         * @param reuse Whether to enable port reuse
+         * @throws socket_exception with type "SocketOption" if setsockopt fails
+         *         or the platform has no SO_REUSEPORT (Windows)
+         *
+         * Lets several sockets bind the same address and port; the kernel then
+         * spreads incoming connections across their accept queues. Must be set
+         * on every participating socket before bind().
+         */
+        void set_reuse_port(bool reuse);
+
         /**
          * @brief Sets socket to non-blocking or blocking mode.
          * @param enable Whether to enable non-blocking mode
@@ -177,7 +194,8 @@ namespace hh_socket
         /**
          * @brief Receive data from any client (UDP only).
          * @param client_addr Will be filled with sender's address
-         * @return Buffer containing received data
+         * @return Buffer containing received data; a slice of a pooled 64KB block if
+         *         at least 16KB arrived (keeping it pins the block), else an exact-size copy
          * @throws socket_exception with type "ProtocolMismatch" if called on non-UDP socket
          * @throws socket_exception with type "SocketReceive" if receive operation fails
          */
@@ -193,6 +211,76 @@ namespace hh_socket
          */
         void send_to(const socket_address &addr, const data_buffer &data);
 
+        /**
+         * @brief Receive up to batch.capacity() datagrams with one syscall (UDP only).
+         * @param batch Preallocated slots; previous contents are discarded
+         * @return Number of datagrams received, also batch.size(); 0 if a
+         *         non-blocking socket has nothing to read
+         * @throws socket_exception with type "ProtocolMismatch" if called on non-UDP socket
+         * @throws socket_exception with type "SocketReceive" if receive operation fails
+         *
+         * Linux uses recvmmsg() with MSG_WAITFORONE: a blocking socket waits
+         * for the first datagram only, then takes whatever else is queued.
+         * Nothing is allocated; senders are read with batch.address(i).
+         * Other platforms receive one datagram per call.
+         */
+        std::size_t receive_batch(datagram_batch &batch);
+
+        /**
+         * @brief Send every datagram pushed into the batch (UDP only).
+         * @param batch Datagrams and their destinations, see datagram_batch::push()
+         * @return Number of datagrams sent; less than batch.size() only if a
+         *         non-blocking socket's send buffer filled up
+         * @throws socket_exception with type "ProtocolMismatch" if called on non-UDP socket
+         * @throws socket_exception with type "SocketSend" if send operation fails
+         *
+         * Linux uses sendmmsg(), one syscall per batch unless the kernel
+         * stops early. Other platforms call sendto() per datagram. The batch
+         * is not cleared.
+         */
+        std::size_t send_batch(datagram_batch &batch);
+
+        /**
+         * @brief Send a buffer as consecutive datagrams of segment_size bytes (UDP only).
+         * @param addr Destination address
+         * @param data Payload; the last datagram carries the remainder
+         * @param segment_size Bytes per datagram
+         * @return true if UDP_SEGMENT offload was used, false if it fell back to one sendto() per datagram
+         * @throws socket_exception with type "ProtocolMismatch" if called on non-UDP socket
+         * @throws socket_exception with type "InvalidArgument" if segment_size is 0
+         * @throws socket_exception with type "SocketSend" if send operation fails
+         *
+         * On Linux 4.18+ up to 64 segments are handed to the kernel in one
+         * sendmsg() with a UDP_SEGMENT control message, and split into
+         * datagrams by the stack (or the NIC). If the kernel rejects the
+         * option the socket remembers it and sends one datagram per syscall
+         * from then on.
+         */
+        bool send_segments(const socket_address &addr, const data_buffer &data, std::size_t segment_size);
+
+        /**
+         * @brief Enables or disables UDP_GRO receive coalescing (UDP only).
+         * @param enable Whether the kernel may merge consecutive datagrams of a flow
+         * @return true if the option was applied, false if the platform or kernel lacks it
+         * @throws socket_exception with type "ProtocolMismatch" if called on non-UDP socket
+         *
+         * With GRO on, one receive can return several datagrams of the same
+         * sender laid end to end; use receive(socket_address &, std::size_t &)
+         * to learn where they split.
+         */
+        bool set_gro(bool enable);
+
+        /**
+         * @brief Receive a datagram, or a run of GRO-coalesced datagrams (UDP only).
+         * @param client_addr Will be filled with sender's address
+         * @param segment_size Will be set to the size of each coalesced datagram (the last
+         *        may be shorter); equals the returned size when nothing was coalesced
+         * @return Buffer containing received data, pooled or copied as for receive(socket_address &)
+         * @throws socket_exception with type "ProtocolMismatch" if called on non-UDP socket
+         * @throws socket_exception with type "SocketReceive" if receive operation fails
+         */
+        data_buffer receive(socket_address &client_addr, std::size_t &segment_size);
+
         /**
          * @brief Get remote endpoint address.
          * @return Socket address of remote endpoint
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <memory>
+#include <type_traits>
 
 #include "ip_address.hpp"
 #include "family.hpp"
@@ -13,9 +14,13 @@ namespace hh_socket
      * @brief Represents a complete socket address combining IP, port, and address family.
      *
      * This class encapsulates all components needed for network socket operations:
-     * IP address, port number, and address family (IPv4/IPv6). It manages the
-     * underlying system sockaddr structures and provides type-safe access to
-     * socket address components.
+     * IP address, port number, and address family (IPv4/IPv6). The system
+     * sockaddr structure is stored inline in a sockaddr_storage and is the only
+     * state: the IP, port and family are decoded from it on demand.
+     *
+     * The layout is trivially copyable, so building, copying and storing an
+     * address never allocates. The textual IP is only produced when to_string()
+     * is called or the ip_address returned by get_ip_address() is formatted.
      *
      * @note Handles both IPv4 (sockaddr_in) and IPv6 (sockaddr_in6) addresses
      * @note Provides automatic conversion between host and network byte order
@@ -23,24 +28,18 @@ namespace hh_socket
     class socket_address
     {
     private:
-        /// IP address component
-        ip_address address;
-
-        /// Address family (IPv4 or IPv6)
-        family family_id;
-
-        /// Port number component
-        port port_id;
+        /// Underlying system socket address structure,
+        /// holds either a sockaddr_in or a sockaddr_in6 (ss_family tells which)
+        sockaddr_storage storage;
 
-        /// Underlying system socket address structure
-        /// may be either sockaddr_in or sockaddr_in6
-        std::shared_ptr<sockaddr> addr;
+        /// Port in host order, 0 if the family is unspecified; never throws, unlike port
+        int port_number() const;
 
     public:
         /**
-         * @brief Default constructor - creates uninitialized socket address.
+         * @brief Default constructor - creates an empty socket address (family AF_UNSPEC).
          */
-        explicit socket_address() = default;
+        socket_address() : storage() {}
 
         /**
          * @brief Construct socket address from components.
@@ -48,8 +47,7 @@ namespace hh_socket
          * @param address IP address default 0.0.0.0
          * @param family_id Address family (IPv4/IPv6) default AF_INET (IPv4)
          *
-         * Creates a socket address by combining IP address, port, and family.
-         * Automatically creates appropriate sockaddr structure internally.
+         * Parses the IP address once into the inline sockaddr structure.
          */
         explicit socket_address(const port &port_id, const ip_address &address = ip_address("0.0.0.0"), const family &family_id = family(IPV4));
 
@@ -57,29 +55,20 @@ namespace hh_socket
          * @brief Construct from system sockaddr_storage structure.
          * @param addr Socket address storage structure
          *
-         * Creates socket address object from existing system address structure.
-         * Extracts IP, port, and family information from the structure.
+         * Copies the structure; nothing is parsed or formatted.
          */
-        explicit socket_address(sockaddr_storage &addr);
+        explicit socket_address(const sockaddr_storage &addr) : storage(addr) {}
 
         /**
-         * @brief Custom copy constructor.
-         * @param other Socket address to copy from
-         *
-         * Creates deep copy of socket address including underlying sockaddr structure.
+         * @brief Construct from a raw sockaddr, e.g. as returned by accept() or recvfrom().
+         * @param addr Pointer to a sockaddr_in or sockaddr_in6
+         * @param len Size of the structure in bytes
          */
-        socket_address(const socket_address &other);
+        socket_address(const sockaddr *addr, socklen_t len);
 
-        /**
-         * @brief Custom copy assignment operator.
-         * @param other Socket address to copy from
-         * @return Reference to this object
-         *
-         * Assigns socket address components and recreates sockaddr structure.
-         */
-        socket_address &operator=(const socket_address &other);
-
-        // Move operations
+        // Copy and move operations: plain memory copies
+        socket_address(const socket_address &) = default;
+        socket_address &operator=(const socket_address &) = default;
         socket_address(socket_address &&) = default;
         socket_address &operator=(socket_address &&) = default;
 
@@ -88,25 +77,26 @@ namespace hh_socket
 
         /**
          * @brief Get the IP address component.
-         * @return IP address object
+         * @return IP address object, copied from the binary address (no formatting)
          */
-        ip_address get_ip_address() const { return address; }
+        ip_address get_ip_address() const;
 
         /**
          * @brief Get the port component.
-         * @return Port object
+         * @return Port object (port() if the family is unspecified)
+         * @throws socket_exception with type "InvalidPort" if the port is below MIN_PORT
          */
-        port get_port() const { return port_id; }
+        port get_port() const;
 
         /**
          * @brief Get the address family component.
          * @return Address family object
          */
-        family get_family() const { return family_id; }
+        family get_family() const { return family(storage.ss_family == IPV6 ? IPV6 : IPV4); }
 
         std::string to_string() const
         {
-            return address.get() + ":" + std::to_string(port_id.get());
+            return get_ip_address().get() + ":" + std::to_string(port_number());
         }
 
         /**
@@ -116,7 +106,10 @@ namespace hh_socket
          * Returns pointer suitable for use with socket system calls like
          * bind(), connect(), accept(), etc.
          */
-        sockaddr *get_sock_addr() const;
+        sockaddr *get_sock_addr() const
+        {
+            return reinterpret_cast<sockaddr *>(const_cast<sockaddr_storage *>(&storage));
+        }
 
         /**
          * @brief Get size of sockaddr structure.
@@ -138,11 +131,14 @@ namespace hh_socket
          */
         friend std::ostream &operator<<(std::ostream &os, const socket_address &sa)
         {
-            os << "IP Address: " << sa.get_ip_address() << ", Port: " << sa.get_port() << ", Family: " << sa.get_family();
+            os << "IP Address: " << sa.get_ip_address() << ", Port: " << sa.port_number() << ", Family: " << sa.get_family();
             return os;
         }
     };
 
+    static_assert(std::is_trivially_copyable<socket_address>::value,
+                  "socket_address must stay a plain memory copy");
+
     /**
      * @brief Helper function to handle IPv4 address initialization.
      * @param addr Socket address object to initialize
@@ -150,7 +146,7 @@ namespace hh_socket
      * @param port_id Port component
      * @param family_id Address family component
      *
-     * Creates and initializes sockaddr_in structure for IPv4 addresses.
+     * Writes a sockaddr_in into the address's inline storage.
      */
     void handle_ipv4(socket_address *addr, const ip_address &address, const port &port_id, const family &family_id);
 
@@ -161,7 +157,7 @@ namespace hh_socket
      * @param port_id Port component
      * @param family_id Address family component
      *
-     * Creates and initializes sockaddr_in6 structure for IPv6 addresses.
+     * Writes a sockaddr_in6 into the address's inline storage.
      */
     void handle_ipv6(socket_address *addr, const ip_address &address, const port &port_id, const family &family_id);
 }
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+
+/**
+ * @file static_epoll_server.hpp
+ * @brief epoll_server variant whose handlers are dispatched at compile time (CRTP)
+ *
+ * epoll_server delivers every received chunk through the virtual
+ * on_message_received(), passing the connection's shared_ptr by value: one
+ * indirect call plus an atomic increment and decrement per chunk.
+ * static_epoll_server<Derived> runs the same event loop instantiated with
+ * Derived's handlers. The per-message handler is a plain member call that
+ * the compiler can inline into the read loop, and the connection is passed
+ * by reference, so the reference count is not touched.
+ *
+ * Everything else (timeouts, watermarks, filters, limits, send_file(),
+ * UDP, epoll_server_group) is inherited from epoll_server unchanged.
+ */
+
+#include <exception>
+#include <memory>
+
+#include "epoll_server.hpp"
+#include "epoll_server_loop.hpp"
+
+namespace hh_socket
+{
+    /**
+     * @brief epoll_server with statically dispatched handlers
+     * @tparam Derived The user's server class, deriving from static_epoll_server<Derived>
+     *
+     * Derived defines any of the handlers below with the same signature;
+     * those it does not define keep the defaults (no-ops, except on_error()
+     * which logs like epoll_server). Handlers must be accessible from this
+     * class: make them public, or declare static_epoll_server<Derived> a
+     * friend.
+     *
+     * - void on_message(connection &conn, const data_buffer &db) — per received chunk, inlined
+     * - void on_waiting() — once per loop iteration, inlined
+     * - void on_open(connection &conn) / void on_close(connection &conn)
+     * - void on_listen() / void on_shutdown()
+     * - void on_error(const std::exception &e)
+     *
+     * Reply with send_message(conn, db) and close with close_connection(conn);
+     * the reference overloads work on the same connection. To refer to a
+     * connection after the handler returns, keep get_handle(conn): the
+     * reference is only valid until on_close() returns.
+     *
+     * on_open(), on_close() and the remaining epoll_server hooks
+     * (on_connection_timeout(), on_write_blocked(), ...) are reached through
+     * one virtual call from the shared loop code; they run once per
+     * connection or per event, not per message.
+     *
+     * @note Runs on the epoll backend; io_uring_server keeps the virtual callbacks.
+     *
+     * Example:
+     * @code
+     * class echo : public static_epoll_server<echo>
+     * {
+     * public:
+     *     echo() : static_epoll_server(10000) {}
+     *     void on_message(connection &conn, const data_buffer &db) { send_message(conn, db); }
+     * };
+     * @endcode
+     */
+    template <class Derived>
+    class static_epoll_server : public epoll_server
+    {
+    private:
+        Derived &derived() { return static_cast<Derived &>(*this); }
+
+    protected:
+        /// Dispatch handed to run_loop(): direct calls into Derived
+        struct static_dispatch
+        {
+            Derived &handler;
+
+            void message(epoll_connection &c, const data_buffer &db) { handler.on_message(*c.conn, db); }
+
+            void waiting() { handler.on_waiting(); }
+        };
+
+        /// Default handler: ignores received data
+        void on_message(connection &, const data_buffer &) {}
+
+        /// Default handler: nothing to do before epoll_wait
+        void on_waiting() {}
+
+        /// Default handler: nothing to do for a new connection
+        void on_open(connection &) {}
+
+        /// Default handler: nothing to do for a closed connection
+        void on_close(connection &) {}
+
+        /// Default handler: nothing to do once listening
+        void on_listen() {}
+
+        /// Default handler: nothing to do after shutdown
+        void on_shutdown() {}
+
+        /// Default handler: logs like epoll_server
+        void on_error(const std::exception &e) { epoll_server::on_exception_occurred(e); }
+
+        // The virtual hooks forward to the handlers, so code paths outside
+        // run_loop() (and callers holding an epoll_server&) reach them too
+
+        void on_message_received(connection_handle h, const data_buffer &db) final
+        {
+            if (connection *conn = get_connection(h))
+                derived().on_message(*conn, db);
+        }
+
+        void on_message_received(std::shared_ptr<connection> conn, const data_buffer &db) final
+        {
+            derived().on_message(*conn, db);
+        }
+
+        void on_waiting_for_activity() final { derived().on_waiting(); }
+
+        void on_connection_opened(connection_handle h) final
+        {
+            if (connection *conn = get_connection(h))
+                derived().on_open(*conn);
+        }
+
+        void on_connection_opened(std::shared_ptr<connection> conn) final { derived().on_open(*conn); }
+
+        void on_connection_closed(connection_handle h) final
+        {
+            if (connection *conn = get_connection(h))
+                derived().on_close(*conn);
+        }
+
+        void on_connection_closed(std::shared_ptr<connection> conn) final { derived().on_close(*conn); }
+
+        void on_listen_success() final { derived().on_listen(); }
+
+        void on_shutdown_success() final { derived().on_shutdown(); }
+
+        void on_exception_occurred(const std::exception &e) final { derived().on_error(e); }
+
+    public:
+        /**
+         * @brief Constructs the server
+         * @param max_fds Maximum number of file descriptors, see epoll_server::epoll_server()
+         */
+        explicit static_epoll_server(int max_fds) : epoll_server(max_fds) {}
+
+        /**
+         * @brief Runs the event loop with Derived's handlers until stop_server()
+         * @param timeout Timeout in milliseconds for epoll_wait
+         */
+        void listen(int timeout) final
+        {
+            static_dispatch dispatch{derived()};
+            run_loop(dispatch, timeout);
+        }
+    };
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+/**
+ * @file timer_wheel.hpp
+ * @brief Hierarchical timing wheel driven by the event loop
+ *
+ * Timers are intrusive: a timer object carries its own list links, so arming,
+ * re-arming and cancelling are O(1) pointer updates with no allocation and no
+ * syscall. The event loop advances the wheel with its cached clock after each
+ * wait and uses next_timeout() to bound the wait, so no timerfd is needed.
+ *
+ * Layout:
+ * - 1 millisecond ticks
+ * - 5 levels of 64 slots; level L covers 64^(L+1) ms (64ms, 4s, 4.4min,
+ *   4.7h, 12.4 days). Longer delays are clamped to the last level.
+ * - Each level keeps a 64-bit occupancy mask, so finding the next expiry
+ *   costs one bit scan per level.
+ * - Timers in higher levels are cascaded down when the wheel reaches their
+ *   slot, so every timer is moved at most once per level.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace hh_socket
+{
+    class timer_wheel;
+
+    /**
+     * @brief A timer that can be armed on a timer_wheel
+     *
+     * The callback is set once (for example when a connection is opened);
+     * arming the timer afterwards only links it into a wheel slot.
+     *
+     * @note A timer must outlive its arming or be cancelled; the destructor
+     *       cancels it automatically.
+     * @note Only the thread running the wheel may arm, cancel or destroy an
+     *       armed timer.
+     */
+    class timer
+    {
+        friend class timer_wheel;
+
+    private:
+        /// Intrusive slot list links
+        timer *prev = nullptr;
+        timer *next = nullptr;
+
+        /// Wheel the timer is armed on, nullptr when idle
+        timer_wheel *wheel = nullptr;
+
+        /// Wheel level and slot the timer is linked into
+        uint8_t level = 0;
+        uint8_t index = 0;
+
+        /// Absolute expiry tick
+        uint64_t expires = 0;
+
+        /// Re-arm interval in ms for periodic timers, 0 for one-shot
+        uint64_t period = 0;
+
+        /// Function invoked on expiry
+        std::function<void()> callback;
+
+        /// Moves other's state (and slot position, if armed) into this idle timer
+        void take_over(timer &other);
+
+    public:
+        /// Creates a timer without a callback
+        timer() = default;
+
+        /**
+         * @brief Creates a timer with its expiry callback
+         * @param cb Function invoked on the loop thread when the timer fires
+         */
+        explicit timer(std::function<void()> cb) : callback(std::move(cb)) {}
+
+        /**
+         * @brief Move constructor
+         * @param other Timer to move from; an armed timer keeps its slot
+         */
+        timer(timer &&other) noexcept;
+
+        /**
+         * @brief Move assignment; cancels this timer first
+         * @param other Timer to move from; an armed timer keeps its slot
+         * @return Reference to this timer
+         */
+        timer &operator=(timer &&other) noexcept;
+
+        timer(const timer &) = delete;
+        timer &operator=(const timer &) = delete;
+
+        /**
+         * @brief Sets the function invoked on expiry
+         * @param cb Callback, typically set once per timer
+         */
+        void set_callback(std::function<void()> cb) { callback = std::move(cb); }
+
+        /**
+         * @brief Check whether the timer is currently armed
+         * @return true if the timer is linked into a wheel
+         */
+        bool armed() const { return wheel != nullptr; }
+
+        /**
+         * @brief Get the absolute expiry time
+         * @return Expiry in wheel milliseconds, meaningful only while armed()
+         */
+        uint64_t expiry() const { return expires; }
+
+        /// Disarms the timer if armed
+        void cancel();
+
+        /// Cancels the timer
+        ~timer() { cancel(); }
+    };
+
+    /**
+     * @brief Hierarchical timing wheel with 1ms resolution
+     *
+     * Time is expressed in milliseconds of std::chrono::steady_clock. The
+     * owner calls advance() with the current time after every wait and
+     * next_timeout() to know how long the next wait may block.
+     */
+    class timer_wheel
+    {
+        friend class timer;
+
+    private:
+        static const unsigned LEVEL_BITS = 6;
+        static const unsigned LEVEL_SIZE = 1u << LEVEL_BITS;
+        static const unsigned LEVELS = 5;
+
+        /// Slot list heads
+        timer *slots[LEVELS][LEVEL_SIZE] = {};
+
+        /// Bit i set when slots[level][i] is non-empty
+        uint64_t occupied[LEVELS] = {};
+
+        /// Current tick, every timer expiring at or before it has fired
+        uint64_t current = 0;
+
+        /// Number of armed timers
+        std::size_t armed_count = 0;
+
+        /// Links an idle timer into the slot for tick `at` (at >= current)
+        void link(timer &t, uint64_t at);
+
+        /// Removes an armed timer from its slot
+        void unlink(timer &t);
+
+        /// Re-inserts every timer of a higher-level slot one level down (or lower)
+        void cascade(unsigned level, unsigned index);
+
+    public:
+        /**
+         * @brief Creates a wheel starting at the current steady_clock time
+         */
+        timer_wheel();
+
+        timer_wheel(const timer_wheel &) = delete;
+        timer_wheel &operator=(const timer_wheel &) = delete;
+
+        /// Disarms every timer still linked
+        ~timer_wheel();
+
+        /**
+         * @brief Reads the monotonic clock
+         * @return Current steady_clock time in milliseconds
+         *
+         * Uses clock_gettime through the vDSO on Linux, so it is not a syscall.
+         */
+        static uint64_t clock_ms();
+
+        /**
+         * @brief Get the wheel's notion of the current time
+         * @return Time in ms up to which timers have been run
+         *
+         * Cached by advance(); cheap enough to call on every read or write.
+         */
+        uint64_t now() const { return current; }
+
+        /**
+         * @brief Arms (or re-arms) a timer to fire after a delay
+         * @param t Timer to arm; if already armed it is moved
+         * @param delay_ms Delay in milliseconds from now() (0 fires on the next advance)
+         */
+        void schedule(timer &t, uint64_t delay_ms);
+
+        /**
+         * @brief Arms a timer that re-arms itself after every expiry
+         * @param t Timer to arm
+         * @param period_ms Interval in milliseconds (minimum 1)
+         */
+        void schedule_every(timer &t, uint64_t period_ms);
+
+        /**
+         * @brief Arms a timer at an absolute time
+         * @param t Timer to arm
+         * @param when_ms Absolute time in wheel milliseconds
+         */
+        void schedule_at(timer &t, uint64_t when_ms);
+
+        /**
+         * @brief Disarms a timer
+         * @param t Timer to disarm; no-op if not armed
+         */
+        void cancel(timer &t);
+
+        /**
+         * @brief Runs every timer that expired up to now_ms
+         * @param now_ms Current time from clock_ms()
+         * @return Number of timers that fired
+         *
+         * Callbacks may arm or cancel any timer, including the one running,
+         * but must not destroy the timer that is running.
+         */
+        std::size_t advance(uint64_t now_ms);
+
+        /**
+         * @brief Computes how long the loop may wait without missing a timer
+         * @param max_timeout Upper bound in ms (-1 for no bound)
+         * @return Milliseconds until the next wheel event, capped by max_timeout
+         *
+         * The next wheel event is either an expiry in the lowest level or the
+         * moment a higher-level slot must be cascaded.
+         */
+        int next_timeout(int max_timeout) const;
+
+        /**
+         * @brief Get the number of armed timers
+         * @return Armed timer count
+         */
+        std::size_t size() const { return armed_count; }
+    };
+}
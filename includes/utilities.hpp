@@ -81,13 +81,13 @@ namespace hh_socket
     // Network address conversion utilities
 
     /**
-     * @brief Convert IP address string to network byte order.
+     * @brief Write an IP address in network byte order.
      * @param family_ip Address family (IPv4 or IPv6)
-     * @param address IP address in string format (e.g., "192.168.1.1")
+     * @param address Parsed IP address (e.g., ip_address("192.168.1.1"))
      * @param addr Output buffer to store network byte order address
-     * @note Cross-platform implementation using inet_pton() or InetPtonA()
+     * @note An IPv4 address written for IPv6 becomes an IPv4-mapped address
      * @note Output buffer must be large enough (4 bytes for IPv4, 16 bytes for IPv6)
-     * @throws No exceptions - caller should validate return value
+     * @note The buffer is left untouched if the address does not fit the family
      */
     void convert_ip_address_to_network_order(const family &family_ip, const ip_address &address, void *addr);
 
@@ -96,10 +96,10 @@ namespace hh_socket
      * @param addr Network address structure (sockaddr_storage)
      * @return IP address in string format
      * @note Supports both IPv4 and IPv6 addresses
-     * @note Uses inet_ntop() for cross-platform compatibility
-     * @note Returns empty string on conversion failure
+     * @note Formats with ip_address (RFC 5952 text), not inet_ntop()
+     * @note Returns empty string for other families
      */
-    std::string get_ip_address_from_network_address(sockaddr_storage &addr);
+    std::string get_ip_address_from_network_address(const sockaddr_storage &addr);
 
     // Port management utilities
 
@@ -224,8 +224,9 @@ namespace hh_socket
      * @param port Port number to listen on
      * @param ip IP address to bind to (default: "0.0.0.0")
      * @param backlog Maximum number of pending connections (default: SOMAXCONN)
+     * @param reuse_port Set SO_REUSEPORT so several listeners can share the port (default: false)
      * @return std::shared_ptr<hh_socket::socket>
      */
-    std::shared_ptr<hh_socket::socket> make_listener_socket(uint16_t port, const std::string &ip = "0.0.0.0", int backlog = SOMAXCONN);
+    std::shared_ptr<hh_socket::socket> make_listener_socket(uint16_t port, const std::string &ip = "0.0.0.0", int backlog = SOMAXCONN, bool reuse_port = false);
 
 }
\ No newline at end of file
@@ -0,0 +1,210 @@
+#pragma once
+
+/**
+ * @file worker_pool.hpp
+ * @brief Work-stealing thread pool with ordered strands
+ *
+ * An event loop runs every callback on its own thread, so one slow message
+ * handler stalls all other connections of that loop. A worker_pool runs
+ * such handlers on other threads. epoll_server::set_worker_pool() routes
+ * received messages through it, one strand per connection, so the
+ * messages of one connection are still handled one at a time and in order.
+ *
+ * Scheduling:
+ * - Each worker owns a queue. Tasks submitted from outside the pool are
+ *   spread round-robin over the queues; tasks submitted by a worker go to
+ *   its own queue.
+ * - A worker takes from the front of its own queue and, when that is
+ *   empty, steals from the back of the others', so a burst landing on one
+ *   queue is shared out.
+ * - A strand is a queue of tasks that is scheduled on the pool as a single
+ *   task while it has work. Different strands run in parallel; the tasks
+ *   of one strand never do.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hh_socket
+{
+    /**
+     * @brief Counters of a worker_pool, to size it
+     *
+     * Depths count tasks submitted and not yet started, including those
+     * waiting in strands.
+     */
+    struct worker_pool_stats
+    {
+        /// Tasks waiting to run now
+        std::size_t queued = 0;
+
+        /// Highest queued value seen
+        std::size_t max_queued = 0;
+
+        /// Tasks submitted so far
+        uint64_t submitted = 0;
+
+        /// Tasks finished so far
+        uint64_t executed = 0;
+
+        /// Scheduled items a worker took from another worker's queue
+        uint64_t stolen = 0;
+    };
+
+    /**
+     * @brief Fixed set of threads running submitted tasks
+     *
+     * @note All member functions are thread-safe.
+     */
+    class worker_pool
+    {
+    public:
+        /// Unit of work
+        using task = std::function<void()>;
+
+        /**
+         * @brief Sequence of tasks run one at a time, in submission order
+         *
+         * Created by make_strand(). Submitting to a strand that is idle
+         * schedules it on the pool; it then runs its tasks until it is
+         * empty, handing the thread back after a bounded batch so other
+         * strands are not starved.
+         */
+        class strand : public std::enable_shared_from_this<strand>
+        {
+            friend class worker_pool;
+
+        private:
+            worker_pool &pool;
+            std::mutex lock;
+            std::deque<task> tasks;
+            /// True while the strand is queued on or running in the pool
+            bool scheduled = false;
+
+            explicit strand(worker_pool &pool) : pool(pool) {}
+
+            /// Runs a batch of tasks on a worker, then reschedules or goes idle
+            void run();
+
+        public:
+            strand(const strand &) = delete;
+            strand &operator=(const strand &) = delete;
+
+            /**
+             * @brief Get the number of tasks waiting in this strand
+             * @return Task count, a snapshot
+             */
+            std::size_t pending();
+        };
+
+        /**
+         * @brief Starts the worker threads
+         * @param threads Number of workers; 0 uses std::thread::hardware_concurrency()
+         */
+        explicit worker_pool(std::size_t threads = 0);
+
+        worker_pool(const worker_pool &) = delete;
+        worker_pool &operator=(const worker_pool &) = delete;
+
+        /// Stops the workers; tasks not started yet are dropped
+        ~worker_pool();
+
+        /**
+         * @brief Runs a task on some worker
+         * @param t Task; an exception it throws is logged and dropped
+         */
+        void submit(task t);
+
+        /**
+         * @brief Creates a strand bound to this pool
+         * @return New strand; it must not outlive the pool
+         */
+        std::shared_ptr<strand> make_strand();
+
+        /**
+         * @brief Runs a task after the tasks already submitted to the same strand
+         * @param s Strand of this pool
+         * @param t Task
+         */
+        void submit(strand &s, task t);
+
+        /**
+         * @brief Blocks until every submitted task has finished
+         *
+         * Tasks submitted meanwhile (also by running tasks) are waited for too.
+         */
+        void wait_idle();
+
+        /**
+         * @brief Get the number of worker threads
+         * @return Thread count
+         */
+        std::size_t size() const { return workers.size(); }
+
+        /**
+         * @brief Get the queue depth and throughput counters
+         * @return Snapshot of the counters
+         */
+        worker_pool_stats get_stats() const;
+
+    private:
+        /// Queue owned by one worker
+        struct alignas(64) worker_queue
+        {
+            std::mutex lock;
+            std::deque<task> items;
+        };
+
+        std::vector<std::unique_ptr<worker_queue>> queues;
+        std::vector<std::thread> workers;
+
+        /// Scheduled items in all queues (strands count once)
+        std::atomic<std::size_t> items{0};
+
+        /// Workers waiting on wakeup
+        std::atomic<std::size_t> sleepers{0};
+
+        /// Sleeping workers and wait_idle() callers wait on these
+        std::mutex idle_lock;
+        std::condition_variable wakeup;
+        std::condition_variable idle;
+
+        /// Round-robin position for submissions from outside the pool
+        std::atomic<std::size_t> next_queue{0};
+
+        std::atomic<bool> stopping{false};
+
+        // Counters, see worker_pool_stats
+        std::atomic<std::size_t> queued{0};
+        std::atomic<std::size_t> max_queued{0};
+        std::atomic<uint64_t> submitted{0};
+        std::atomic<uint64_t> executed{0};
+        std::atomic<uint64_t> stolen{0};
+
+        /// Tasks submitted and not finished, for wait_idle()
+        std::atomic<std::size_t> unfinished{0};
+
+        /// Counts a new task before it is queued
+        void count_submitted();
+
+        /// Runs one task and counts it finished
+        void execute(task &t);
+
+        /// Queues a scheduled item (a task, or a strand's run) and wakes a worker
+        void schedule(task item);
+
+        /// Takes an item from own queue, else steals one; false if all queues are empty
+        bool take(std::size_t self, task &out);
+
+        /// Body of worker thread self
+        void work(std::size_t self);
+    };
+}
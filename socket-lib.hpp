@@ -10,15 +10,27 @@
 #endif
 #endif
 
+#include "includes/buffer_pool.hpp"
 #include "includes/connection.hpp"
+#include "includes/connection_handle.hpp"
+#include "includes/connection_table.hpp"
 #include "includes/data_buffer.hpp"
+#include "includes/datagram_batch.hpp"
 #include "includes/epoll_server.hpp"
+#include "includes/epoll_server_group.hpp"
 #include "includes/exceptions.hpp"
 #include "includes/family.hpp"
 #include "includes/file_descriptor.hpp"
+#include "includes/io_uring_server.hpp"
 #include "includes/ip_address.hpp"
+#include "includes/ip_filter.hpp"
+#include "includes/ip_limiter.hpp"
+#include "includes/mpsc_queue.hpp"
 #include "includes/port.hpp"
 #include "includes/socket_address.hpp"
 #include "includes/socket.hpp"
+#include "includes/static_epoll_server.hpp"
 #include "includes/tcp_server.hpp"
-#include "includes/utilities.hpp"
\ No newline at end of file
+#include "includes/timer_wheel.hpp"
+#include "includes/utilities.hpp"
+#include "includes/worker_pool.hpp"
\ No newline at end of file
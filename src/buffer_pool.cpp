@@ -0,0 +1,59 @@
+/**
+ * @file buffer_pool.cpp
+ * @brief Implementation of the receive block pool
+ */
+
+#include "../includes/buffer_pool.hpp"
+
+namespace hh_socket
+{
+    buffer_pool::buffer_pool(std::size_t block_size, std::size_t max_blocks)
+        : block_bytes(block_size), max_blocks(max_blocks)
+    {
+        blocks.reserve(max_blocks);
+    }
+
+    /**
+     * Algorithm:
+     * 1. Scan the pooled blocks round-robin, starting after the last block
+     *    handed out, for one referenced only by the pool
+     * 2. Otherwise allocate a new block, and keep it if there is room
+     *
+     * Blocks are usually released in the order they were lent out, so the
+     * scan normally stops at its first candidate.
+     */
+    std::shared_ptr<std::string> buffer_pool::acquire()
+    {
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            std::shared_ptr<std::string> &block = blocks[next];
+            next = next + 1 == blocks.size() ? 0 : next + 1;
+            if (block.use_count() == 1)
+            {
+                // Pairs with the release of the last slice on another thread
+                std::atomic_thread_fence(std::memory_order_acquire);
+                hit_count.store(hit_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return block;
+            }
+        }
+
+        miss_count.store(miss_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        auto block = std::make_shared<std::string>(block_bytes, '\0');
+        if (blocks.size() < max_blocks)
+            blocks.push_back(block);
+        return block;
+    }
+
+    data_buffer buffer_pool::take(std::shared_ptr<std::string> block, std::size_t size) const
+    {
+        if (size < block_bytes / 4)
+            return data_buffer(block->data(), size);
+        return data_buffer(std::move(block), 0, size);
+    }
+
+    buffer_pool &thread_receive_pool()
+    {
+        static thread_local buffer_pool pool(MAX_BUFFER_SIZE, 8);
+        return pool;
+    }
+}
@@ -1,4 +1,5 @@
 #include "../includes/connection.hpp"
+#include "../includes/buffer_pool.hpp"
 #include "../includes/utilities.hpp"
 namespace hh_socket
 {
@@ -37,6 +38,10 @@ namespace hh_socket
      * Uses ::recv() system call in loop to receive all available data.
      * Continues reading until no more data available or connection closed.
      * Handles non-blocking sockets by checking for EAGAIN/EWOULDBLOCK.
+     * Receives into a block from a per-thread pool. Large reads are returned
+     * as a slice of it, reused once the caller releases the buffer; reads
+     * under a quarter of the block are copied out so a retained buffer does
+     * not pin 64KB.
      */
     data_buffer connection::receive()
     {
@@ -45,10 +50,10 @@ namespace hh_socket
             return data_buffer();
         }
 
-        data_buffer received_data;
-        char buffer[MAX_BUFFER_SIZE];
+        buffer_pool &receive_pool = thread_receive_pool();
+        std::shared_ptr<std::string> block = receive_pool.acquire();
 
-        int bytes_received = ::recv(fd.get(), buffer, sizeof(buffer), 0);
+        int bytes_received = ::recv(fd.get(), &(*block)[0], static_cast<int>(block->size()), 0);
 
         /// EOF
         if (bytes_received == 0)
@@ -79,8 +84,7 @@ EINTR: The function call was interrupted by a signal.
             throw socket_exception("Failed to read data for fd " + std::to_string(fd.get()) + " " + std::string(get_error_message()), "SocketRead", __func__);
         }
 
-        received_data.append(buffer, bytes_received);
-        return received_data;
+        return receive_pool.take(std::move(block), static_cast<std::size_t>(bytes_received));
     }
 
     void connection::close()
@@ -0,0 +1,99 @@
+/**
+ * @file datagram_batch.cpp
+ * @brief Implementation of the preallocated datagram slots
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "../includes/datagram_batch.hpp"
+#include "../includes/exceptions.hpp"
+
+namespace hh_socket
+{
+    /**
+     * Layout:
+     * - One payload allocation of capacity * datagram_size bytes
+     * - On Linux, header i permanently points at iovec i and address i, so
+     *   a batched syscall needs no setup beyond resetting the lengths the
+     *   kernel overwrites
+     */
+    datagram_batch::datagram_batch(std::size_t capacity, std::size_t datagram_size)
+        : slot_bytes(datagram_size)
+    {
+        if (capacity == 0 || datagram_size == 0)
+            throw std::invalid_argument("datagram_batch needs at least one slot of at least one byte");
+
+        storage.resize(capacity * datagram_size);
+        addrs.resize(capacity);
+#if defined(__linux__) || defined(__linux)
+        headers.resize(capacity);
+        iovs.resize(capacity);
+        for (std::size_t i = 0; i < capacity; ++i)
+        {
+            iovs[i].iov_base = data(i);
+            iovs[i].iov_len = slot_bytes;
+            std::memset(&headers[i], 0, sizeof(mmsghdr));
+            headers[i].msg_hdr.msg_name = &addrs[i];
+            headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            headers[i].msg_hdr.msg_iov = &iovs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+#else
+        lengths.resize(capacity);
+        addr_lens.resize(capacity);
+        truncs.resize(capacity);
+#endif
+    }
+
+    /**
+     * recvmmsg() overwrites msg_namelen with the sender's address length and
+     * push() shortens iov_len to the payload size, so both are restored for
+     * every slot before receiving into it.
+     */
+    void datagram_batch::prepare_receive()
+    {
+        count = 0;
+#if defined(__linux__) || defined(__linux)
+        for (std::size_t i = 0; i < headers.size(); ++i)
+        {
+            iovs[i].iov_len = slot_bytes;
+            headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            headers[i].msg_hdr.msg_flags = 0;
+        }
+#endif
+    }
+
+    socket_address datagram_batch::peer(std::size_t i) const
+    {
+        return socket_address(addrs[i]);
+    }
+
+    bool datagram_batch::push(const sockaddr *to, socklen_t to_len, const char *payload, std::size_t len)
+    {
+        if (full())
+            return false;
+        if (len > slot_bytes)
+            throw socket_exception("Datagram of " + std::to_string(len) + " bytes exceeds the batch slot size of " +
+                                       std::to_string(slot_bytes),
+                                   "DatagramTooLarge", __func__);
+        if (to_len > static_cast<socklen_t>(sizeof(sockaddr_storage)))
+            to_len = static_cast<socklen_t>(sizeof(sockaddr_storage));
+
+        std::size_t i = count++;
+        std::memcpy(data(i), payload, len);
+        std::memcpy(&addrs[i], to, to_len);
+#if defined(__linux__) || defined(__linux)
+        iovs[i].iov_len = len;
+        headers[i].msg_len = static_cast<unsigned>(len);
+        headers[i].msg_hdr.msg_namelen = to_len;
+        headers[i].msg_hdr.msg_flags = 0;
+#else
+        lengths[i] = len;
+        addr_lens[i] = to_len;
+        truncs[i] = 0;
+#endif
+        return true;
+    }
+}
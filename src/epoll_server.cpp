@@ -23,28 +23,36 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <string.h>
 
 #if defined(__linux__) || defined(__linux)
 #include <arpa/inet.h>
+#include <linux/errqueue.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/resource.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #else
+#include <io.h>
 #define EPOLLET 0
 #define EPOLLEXCLUSIVE 0
 #define EPOLLWAKEUP 0
 #endif
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <functional>
 #include <thread>
 
 #include "../includes/epoll_server.hpp"
+#include "../includes/epoll_server_loop.hpp"
 #include "../includes/port.hpp"
 #include "../includes/socket_address.hpp"
 #include "../includes/utilities.hpp"
@@ -52,6 +60,18 @@
 
 namespace hh_socket
 {
+    namespace
+    {
+#if defined(__linux__) || defined(__linux)
+        /// Deleter of the descriptors duplicated by send_file()
+        void close_file(file_descriptor *f)
+        {
+            ::close(f->get());
+            delete f;
+        }
+#endif
+    }
+
     void epoll_server::try_accept()
     {
 
@@ -99,22 +119,7 @@ namespace hh_socket
                 // Optional: disable Nagle for latency-sensitive workloads.
                 // int one = 1; setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
 
-                // Add new connection to epoll monitoring
-                if (add_epoll(cfd, EPOLLIN | EPOLLET) < 0)
-                {
-                    close_socket(cfd);
-                    throw std::runtime_error("epoll_ctl ADD conn error: " + std::string(strerror(errno)));
-                    continue;
-                }
-
-                // Create connection object and add to tracking
-                auto connptr = std::make_shared<connection>(file_descriptor(cfd),
-                                                            listener_socket->get_bound_address(),
-                                                            socket_address(client_addr));
-                current_open_connections++;
-                conns.emplace(cfd, epoll_connection{connptr, {}, false});
-
-                on_connection_opened(connptr);
+                accept_conn(cfd, client_addr);
             }
             catch (const std::exception &e)
             {
@@ -124,42 +129,140 @@ namespace hh_socket
         }
     }
 
-    void epoll_server::try_read(epoll_connection &c)
+    void epoll_server::accept_conn(socket_t cfd, sockaddr_storage &client_addr)
     {
-        try
+        // Denied and over-limit peers are dropped before any connection state exists
+        if (!admit_peer(cfd, client_addr))
         {
-            char buf[64 * 1024]; // 64KB buffer for high throughput
-            std::size_t sz = 64 * 1024;
-            int fd = c.conn->get_fd();
-            // Read as much data as possible (edge-triggered)
-            while (!c.want_close)
+            close_socket(cfd);
+            return;
+        }
+
+        // Create the connection state first: its slot generation goes into the epoll token
+        open_conn(cfd, client_addr);
+
+        // Add new connection to epoll monitoring
+        if (add_epoll(cfd, EPOLLIN | EPOLLET) < 0)
+        {
+            int err = errno;
+            close_conn(cfd);
+            throw std::runtime_error("epoll_ctl ADD conn error: " + std::string(strerror(err)));
+        }
+    }
+
+    /**
+     * The version check is the only shared access on the accept path; the
+     * shared_ptr itself is only loaded again after set_rules() was called.
+     * The filter runs first so denied peers never take a limiter entry.
+     */
+    bool epoll_server::admit_peer(socket_t cfd, const sockaddr_storage &client_addr)
+    {
+        if (!accept_filter && !accept_limiter.active())
+            return true;
+        ip_address peer = ip_address::from_sockaddr(client_addr);
+        if (accept_filter)
+        {
+            uint64_t version = accept_filter->get_version();
+            if (version != accept_rules_version)
             {
-                std::size_t m = ::recv(fd, buf, sz, 0);
-                if (m > 0)
-                {
-                    on_message_received(c.conn, data_buffer(buf, m));
-                }
-                else if (m == 0)
-                {
-                    // Peer closed connection gracefully
-                    close_conn(fd);
-                    return;
-                }
-                else
-                {
-                    // Error or would block
-                    if (errno == EAGAIN || errno == EWOULDBLOCK)
-                        break; // No more data available
-                    // Connection error, close it
-                    close_conn(fd);
-                    return;
-                }
+                accept_rules = accept_filter->get_rules();
+                accept_rules_version = version;
+            }
+            if (accept_rules && accept_rules->evaluate(peer) == ip_filter_action::deny)
+            {
+                ++filtered_count;
+                return false;
             }
         }
-        catch (const std::exception &e)
+        if (accept_limiter.admit(peer, loop_time))
+            return true;
+        if (accept_limiter.get_limits().reset_over_limit)
         {
-            on_exception_occurred(e);
+            linger lg{1, 0};
+            ::setsockopt(cfd, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char *>(&lg), sizeof(lg));
+        }
+        return false;
+    }
+
+    void epoll_server::set_ip_filter(std::shared_ptr<ip_filter> filter)
+    {
+        accept_filter = std::move(filter);
+        accept_rules_version = accept_filter ? accept_filter->get_version() : 0;
+        accept_rules = accept_filter ? accept_filter->get_rules() : nullptr;
+    }
+
+    /**
+     * Shared by every accept path (epoll accept loop, io_uring multishot
+     * accept), so connection bookkeeping and on_connection_opened() behave
+     * the same whichever backend accepted the socket.
+     */
+    void epoll_server::open_conn(int cfd, sockaddr_storage &client_addr)
+    {
+        // Sockets handed over by an acceptor thread arrive without a listener here
+        socket_address local;
+        if (listener_socket)
+            local = listener_socket->get_bound_address();
+        else
+        {
+            sockaddr_storage bound{};
+            socklen_t bound_len = sizeof(bound);
+            if (::getsockname(cfd, reinterpret_cast<sockaddr *>(&bound), &bound_len) == 0)
+                local = socket_address(bound);
+        }
+
+        // The connection that migrated away on this fd number has closed on its new loop
+        if (!forwards.empty())
+            forwards.erase(cfd);
+
+        // Take the state a previous connection on this fd retired, if any
+        bool reused = false;
+        epoll_connection &c = conns.revive(cfd, reused);
+        ++(reused ? pool_stats.states_reused : pool_stats.states_allocated);
+        current_open_connections++;
+        load_connections.fetch_add(1, std::memory_order_relaxed);
+        if (c.conn)
+        {
+            // Only kept by recycle() when no one else references it
+            *c.conn = connection(file_descriptor(cfd), local, socket_address(client_addr));
+            ++pool_stats.connections_reused;
+        }
+        else
+        {
+            c.conn = std::make_shared<connection>(file_descriptor(cfd), local, socket_address(client_addr));
+            ++pool_stats.connections_allocated;
+        }
+
+        // Timer callback fits std::function's inline storage: no allocation
+        c.deadline.set_callback([this, cfd]
+                                { on_deadline(cfd); });
+        c.last_read = c.last_write = loop_time;
+        c.idle_timeout = default_idle_timeout;
+        c.read_timeout = default_read_timeout;
+        c.write_timeout = default_write_timeout;
+        c.high_watermark = default_high_watermark;
+        c.low_watermark = default_low_watermark;
+        c.ip_counted = accept_limiter.active(); // admit_peer() just counted it
+        arm_deadline(c);
+
+        on_connection_opened(connection_handle{cfd, conns.generation(cfd)});
+    }
+
+    std::size_t epoll_server::prepare_read_block()
+    {
+        const std::size_t block_size = recv_pool.block_size(); // 64KB block for high throughput
+        if (!read_block || block_size - read_used < block_size / 4)
+        {
+            // Slices of the old block stay valid for as long as they are referenced
+            read_block = recv_pool.acquire();
+            read_used = 0;
         }
+        return block_size - read_used;
+    }
+
+    void epoll_server::try_read(epoll_connection &c)
+    {
+        virtual_dispatch dispatch{*this};
+        read_stream(c, dispatch);
     }
 #if defined(__linux__) || defined(__linux)
 
@@ -178,14 +281,16 @@ namespace hh_socket
     /**
      * Implementation Notes:
      * - Uses EPOLL_CTL_ADD operation
-     * - Stores file descriptor in event data for easy retrieval
+     * - Stores fd + slot generation in event data (see make_event_token()), so
+     *   an event queued for a connection that was closed and whose fd was
+     *   reused within the same epoll_wait batch is recognised as stale
      * - Edge-triggered mode requires careful handling of partial I/O
      */
     int epoll_server::add_epoll(int fd, uint32_t ev)
     {
         epoll_event e{};
         e.events = ev;
-        e.data.fd = fd;
+        e.data.u64 = make_event_token(fd, conns.generation(fd));
 
         return ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &e);
     }
@@ -199,8 +304,7 @@ namespace hh_socket
     {
         epoll_event e{};
         e.events = ev;
-        e.data.fd = fd;
-        // std::cout << fd << " " << ev << std::endl;
+        e.data.u64 = make_event_token(fd, conns.generation(fd));
         return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &e);
     }
 
@@ -221,29 +325,131 @@ namespace hh_socket
      * Implementation Notes:
      * - Order of operations is important for proper cleanup
      * - Callbacks are called before resource deallocation
-     * - Uses utility function close_socket() for cross-platform compatibility
+     * - Closes through connection::close() so the fd is closed exactly once
      */
     void epoll_server::close_conn(int fd)
     {
+        epoll_connection *c = conns.find(fd);
+        if (!c)
+            return;
         current_open_connections--;
+        load_connections.fetch_sub(1, std::memory_order_relaxed);
         del_epoll(fd);
-        on_connection_closed(conns[fd].conn);
-        close_socket(fd);
-        conns.erase(fd);
+        account_written(*c, c->out_bytes); // Output that will never be sent
+#if defined(__linux__) || defined(__linux)
+        if (!c->zc_holds.empty())
+        {
+            // The kernel may still read the held buffers: reset the connection
+            // so it drops them instead of sending memory that is about to be freed
+            linger lg{1, 0};
+            ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        }
+#endif
+        std::shared_ptr<connection> conn = c->conn;
+        if (c->ip_counted)
+            accept_limiter.release(conn->get_remote_address().get_ip_address());
+        on_connection_closed(handle_of(*c));
+        // Close through the connection so its destructor cannot close the fd
+        // a second time after the number was reused by another accept
+        conn->close();
+        conn.reset();
+        if (conns.retired() < pool_limit)
+        {
+            c->recycle();
+            conns.retire(fd);
+        }
+        else
+            conns.erase(fd);
+    }
+
+    /**
+     * deque::clear() keeps one chunk of storage, so a reused connection's
+     * first queued messages do not allocate. The connection object is only
+     * kept when this state holds the last reference: one still referenced
+     * by the application must not be reinitialised under it.
+     */
+    void epoll_connection::recycle()
+    {
+        if (conn && conn.use_count() > 1)
+            conn.reset();
+        outq.clear();
+        out_offset = 0;
+        want_write = false;
+        want_close = false;
+        read_stopped = false;
+        flush_pending = false;
+        want_abort = false;
+        deadline.cancel();
+        last_read = 0;
+        last_write = 0;
+        idle_timeout = 0;
+        read_timeout = 0;
+        write_timeout = 0;
+        out_bytes = 0;
+        high_watermark = 0;
+        low_watermark = 0;
+        write_blocked = false;
+        read_interest = true;
+        out_files.clear();
+        out_queued = 0;
+        out_written = 0;
+        zerocopy = 0;
+        zc_next_seq = 0;
+        zc_holds.clear();
+        ip_counted = false;
+        if (strand && strand.use_count() > 1)
+            strand.reset(); // Still queued on the pool for the closed connection
+    }
+
+    /**
+     * Algorithm:
+     * 1. Pops the sent messages from the front of the queue
+     * 2. Keeps the remainder of a partially sent message in place and
+     *    records how much of it was sent in out_offset
+     *
+     * The message is never erased or copied, so a partial write of a large
+     * payload costs O(1) instead of a memmove of the unsent tail.
+     */
+    void epoll_server::consume_written(epoll_connection &c, std::size_t n)
+    {
+        if (n > 0)
+        {
+            c.last_write = loop_time;
+            c.out_written += n;
+            account_written(c, n);
+        }
+        while (n > 0 && !c.outq.empty())
+        {
+            std::size_t remaining = c.outq.front().size() - c.out_offset;
+            if (n < remaining)
+            {
+                c.out_offset += n;
+                return;
+            }
+            n -= remaining;
+            c.outq.pop_front();
+            c.out_offset = 0;
+        }
     }
 
     /**
      * Algorithm:
-     * 1. Process each queued message in order
-     * 2. Skip empty messages (cleanup)
-     * 3. Attempt to send data using ::send()
-     * 4. Handle partial sends by updating message content
-     * 5. Stop on EAGAIN/EWOULDBLOCK (socket buffer full)
-     * 6. Return false on any other error
+     * 1. Gather up to IOV_MAX queued messages into an iovec array, starting
+     *    at out_offset inside the front message
+     * 2. Send them with a single sendmsg() (MSG_NOSIGNAL avoids SIGPIPE)
+     * 3. Drop what was written via consume_written()
+     * 4. A short write means the socket buffer is full: stop without issuing
+     *    another syscall that would only return EAGAIN
+     * 5. Return false on EAGAIN/EWOULDBLOCK or any other error
+     *
+     * A batch of at least zerocopy_threshold bytes is sent with MSG_ZEROCOPY;
+     * the messages it covers are copied (refcount only) into a zerocopy_hold
+     * so they outlive consume_written() until the kernel's completion.
      *
      * Edge Cases Handled:
-     * - Empty messages in queue
+     * - Empty messages in queue (skipped while gathering)
      * - Partial sends (socket buffer full)
+     * - Queues longer than IOV_MAX (sent in several batches)
      * - Connection errors during send
      * - Exception safety with try-catch
      */
@@ -251,29 +457,99 @@ namespace hh_socket
     {
         try
         {
+            int fd = c.conn->get_fd();
+#if defined(__linux__) || defined(__linux)
+            iovec iov[IOV_MAX];
+            while (c.has_output())
+            {
+                if (c.file_at_head())
+                {
+                    if (!flush_file(c))
+                        return false; // Socket buffer is full
+                    continue;
+                }
+
+                // Gather only the buffers queued before the next file segment
+                uint64_t limit = c.out_files.empty() ? UINT64_MAX : c.out_files.front().stream_pos - c.out_written;
+                int count = 0;
+                std::size_t scanned = 0;
+                std::size_t total = 0;
+                std::size_t offset = c.out_offset;
+                for (auto it = c.outq.begin(); it != c.outq.end() && count < IOV_MAX && total < limit; ++it, ++scanned)
+                {
+                    if (it->size() > offset)
+                    {
+                        iov[count].iov_base = const_cast<char *>(it->data()) + offset;
+                        iov[count].iov_len = it->size() - offset;
+                        total += iov[count].iov_len;
+                        ++count;
+                    }
+                    offset = 0;
+                }
+                if (count == 0)
+                {
+                    // Only empty messages were queued
+                    c.outq.clear();
+                    c.out_offset = 0;
+                    break;
+                }
+
+                msghdr msg{};
+                msg.msg_iov = iov;
+                msg.msg_iovlen = count;
+                bool zc = zerocopy_threshold && total >= zerocopy_threshold && enable_zerocopy(c);
+                ssize_t n = ::sendmsg(fd, &msg, zc ? MSG_NOSIGNAL | MSG_ZEROCOPY : MSG_NOSIGNAL);
+                if (n < 0 && zc && errno == ENOBUFS)
+                {
+                    // No memory left for completion notifications: send this batch with a copy
+                    zc = false;
+                    ++zc_stats.refused;
+                    n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+                }
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    // EAGAIN/EWOULDBLOCK: socket buffer is full, otherwise a send error
+                    return false;
+                }
+                if (zc)
+                {
+                    zerocopy_hold hold;
+                    hold.seq = c.zc_next_seq++;
+                    hold.buffers.assign(c.outq.begin(), c.outq.begin() + scanned);
+                    c.zc_holds.push_back(std::move(hold));
+                    ++zc_stats.sends;
+                }
+                consume_written(c, static_cast<std::size_t>(n));
+                if (static_cast<std::size_t>(n) < total)
+                {
+                    // Short write - the socket buffer is full
+                    return false;
+                }
+            }
+            return true;
+#else
             while (!c.outq.empty())
             {
-                std::string &front = c.outq.front();
-                if (front.empty())
+                data_buffer &front = c.outq.front();
+                if (front.size() <= c.out_offset)
                 {
                     c.outq.pop_front();
+                    c.out_offset = 0;
                     continue;
                 }
-                std::size_t n = ::send(c.conn->get_fd(), front.data(), front.size(), 0);
+                auto n = ::send(fd, front.data() + c.out_offset, (int)(front.size() - c.out_offset), 0);
                 if (n > 0)
                 {
-                    front.erase(0, (size_t)n);
+                    consume_written(c, (std::size_t)n);
                     continue;
                 }
-                if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
-                {
-                    // Cannot write more now - socket buffer is full
-                    return false;
-                }
-                // Error occurred during send operation
+                // Cannot write more now - socket buffer is full, or a send error
                 return false;
             }
             return true;
+#endif
         }
         catch (const std::exception &e)
         {
@@ -283,146 +559,100 @@ namespace hh_socket
     }
 
     /**
-     * Event Loop Algorithm:
-     * 1. Wait for events using epoll_wait()
-     * 2. Handle timeout and error conditions
-     * 3. Auto-resize event buffer if needed
-     * 4. Process each ready event:
-     *    - New connections (listener socket)
-     *    - Incoming data (EPOLLIN)
-     *    - Socket ready for writing (EPOLLOUT)
-     *    - Connection errors/closures
-     * 5. Repeat until stop signal
-     *
-     * Performance Features:
-     * - Edge-triggered epoll for minimal syscalls
-     * - Batch event processing
-     * - Non-blocking accept loop for connection bursts
-     * - Intelligent write flow control
-     * - Dynamic event buffer sizing
-     *
-     * Error Handling:
-     * - Graceful degradation on individual connection errors
-     * - Exception isolation prevents server crashes
-     * - Automatic cleanup of failed connections
+     * Flushes the output queue and keeps EPOLLOUT registered only while data
+     * remains, so an idle writable socket does not wake the loop. EPOLLIN is
+     * dropped while the connection is write-blocked. epoll_ctl is only called
+     * when the interest actually changes, and always when a blocked
+     * connection resumes: EPOLL_CTL_MOD re-checks readiness, so data that
+     * arrived while reading was paused is reported even without a new edge.
      */
-    void epoll_server::epoll_loop(int timeout)
+    void epoll_server::flush_and_update_interest(epoll_connection &c)
     {
-        on_listen_success();
-        while (!g_stop)
-            try
-            {
-                on_waiting_for_activity();
-                // Wait for events with specified timeout
-                int n = epoll_wait(epoll_fd, events.data(), (int)events.size(), timeout);
-                if (n < 0)
-                {
-                    if (errno == EINTR)
-                        continue; // Interrupted by signal, continue
-                    // Fatal error in epoll_wait
-                    on_exception_occurred(std::runtime_error("epoll_wait failed: " + std::string(strerror(errno))));
-                    break;
-                }
-
-                // Auto-resize event buffer if saturated (indicates high load)
-                if (n == (int)events.size())
-                {
-                    // grow event buffer if saturated
-                    events.resize(events.size() * 2);
-                }
-                // Process each ready event
-                for (int i = 0; i < n; ++i)
-                {
-                    uint32_t ev = events[i].events;
-                    int fd = events[i].data.fd;
-
-                    // Handle new connections on listener socket
-                    if (listener_socket && fd == listener_socket->get_fd())
-                    {
-                        try_accept();
-                        continue;
-                    }
-
-                    // Find connection state for this file descriptor
-                    auto it = conns.find(fd);
-                    if (it == conns.end())
-                    {
-                        continue; // Connection not found, skip
-                    }
-                    epoll_connection &c = it->second;
-
-                    // Handle write flow control and output queue management
-                    if (!c.outq.empty())
-                    {
-                        // Try to flush immediately to avoid extra EPOLLOUT wakeup
-                        if (flush_writes(c))
-                        {
-                            // All data sent, disable write monitoring if enabled
-                            if (c.want_write)
-                            {
-                                c.want_write = false;
-                                mod_epoll(fd, EPOLLIN | EPOLLET);
-                            }
-                        }
-                        else
-                        {
-                            // Data remains, ensure write monitoring is enabled
-                            if (!c.want_write)
-                            {
-                                c.want_write = true;
-                                mod_epoll(fd, EPOLLIN | EPOLLOUT | EPOLLET);
-                            }
-                        }
-                    }
+        int fd = c.conn->get_fd();
+        // Data remains: wait for the socket to become writable
+        bool want_write = !flush_writes(c);
+        bool drained = c.write_blocked && release_write_block(c);
+        bool want_read = !c.write_blocked;
 
-                    // Handle socket ready for writing (EPOLLOUT)
-                    if (ev & EPOLLOUT)
-                    {
-                        if (flush_writes(c))
-                        {
-                            // All data sent, disable write monitoring
-                            c.want_write = false;
-                            mod_epoll(fd, EPOLLIN | EPOLLET);
-                        }
-                        // If flush_writes returns false, keep EPOLLOUT enabled
-                    }
-
-                    // Handle connection errors and closures
-                    if (ev & (EPOLLERR | EPOLLHUP))
-                    {
-                        if (!c.want_write)
-                            close_conn(fd);
-                        continue;
-                    }
+        if (drained || want_write != c.want_write || want_read != c.read_interest)
+        {
+            c.want_write = want_write;
+            c.read_interest = want_read;
+            mod_epoll(fd, (want_read ? uint32_t(EPOLLIN) : 0u) | (want_write ? uint32_t(EPOLLOUT) : 0u) | EPOLLET);
+        }
+        if (drained)
+            on_write_drained(c.conn);
+    }
 
-                    // Handle custom close events (requested by application)
-                    if (ev & HAMZA_CUSTOM_CLOSE_EVENT)
-                    {
-                        if (!c.want_write)
-                            close_conn(fd);
-                        continue;
-                    }
+    /**
+     * Processing Steps:
+     * 1. Take every connection that queued output or requested a close since
+     *    the last call
+     * 2. Skip entries whose connection was closed in the meantime
+     * 3. Flush each queue with one gathered write; register EPOLLOUT only if
+     *    the socket could not take everything
+     * 4. Close connections that requested it and have nothing left to send
+     *
+     * Because send_message() only records the connection here, a burst of
+     * pipelined responses is written with a single sendmsg() and usually no
+     * epoll_ctl at all.
+     */
+    void epoll_server::flush_pending_writes()
+    {
+        // Swap out the list: close callbacks may queue more entries
+        while (!pending_flush.empty())
+        {
+            pending_swap.swap(pending_flush);
+            for (int fd : pending_swap)
+            {
+                epoll_connection *found = conns.find(fd);
+                if (!found)
+                    continue; // Connection already closed
+                epoll_connection &c = *found;
+                c.flush_pending = false;
 
-                    // Handle incoming data (EPOLLIN)
-                    if (ev & EPOLLIN)
-                    {
-                        try_read(c);
-                    }
+                if (c.has_output() || c.write_blocked)
+                    flush_and_update_interest(c);
 
-                next_event:
-                    continue;
-                }
-                // After processing all events, you try to accept the connections that failed
-                if (listener_socket)
-                    try_accept();
+                if (c.ready_to_close())
+                    close_conn(fd);
             }
-            catch (const std::exception &e)
+            pending_swap.clear();
+        }
+
+        // No callback runs while flushing datagrams, so the list cannot grow here
+        for (int fd : udp_pending)
+        {
+            if (udp_endpoint *u = udp_endpoints.find(fd))
             {
-                std::cerr << "UNKNOWN ERROR CAUGHT BY EVENT LOOP: " << e.what() << std::endl;
-                on_exception_occurred(e);
+                u->flush_pending = false;
+                flush_datagrams(*u);
             }
+        }
+        udp_pending.clear();
+    }
+
+    /**
+     * Adds a connection to the list flushed before the next epoll_wait.
+     * Connections already waiting for EPOLLOUT are flushed by the event itself.
+     */
+    void epoll_server::schedule_flush(epoll_connection &c)
+    {
+        if (!c.flush_pending)
+        {
+            c.flush_pending = true;
+            pending_flush.push_back(c.conn->get_fd());
+        }
+    }
 
-        on_shutdown_success();
+    /**
+     * The loop itself lives in epoll_server_loop.hpp; this instantiation
+     * dispatches through the virtual callbacks.
+     */
+    void epoll_server::epoll_loop(int timeout)
+    {
+        virtual_dispatch dispatch{*this};
+        run_loop(dispatch, timeout);
     }
 
     // ============================================================================
@@ -431,98 +661,1128 @@ namespace hh_socket
 
     /**
      * Implementation Details:
-     * - Uses custom epoll event (HAMZA_CUSTOM_CLOSE_EVENT) for signaling
-     * - Defers actual closure to the main event loop
+     * - Marks the connection with want_close and schedules it for the
+     *   pending-write pass, which runs before the next epoll_wait
+     * - Defers actual closure to the main event loop, after queued output
+     *   has been flushed
      * - Handles case where connection might already be closed
-     * - Thread-safe approach via epoll signaling mechanism
      */
     void epoll_server::close_connection(std::shared_ptr<connection> conn)
     {
-        auto c = conns.find(conn->get_fd());
-        int fd = conn->get_fd();
-        if (c == conns.end())
-            return; // Connection already closed
-        conns[fd].want_close = true;
-        mod_epoll(fd, HAMZA_CUSTOM_CLOSE_EVENT);
+        close_connection(conn->get_fd());
     }
 
-    void epoll_server::stop_reading_from_connection(std::shared_ptr<connection> conn)
+    void epoll_server::close_connection(connection_handle h)
     {
-        auto c = conns.find(conn->get_fd());
-        if (c != conns.end())
+        if (epoll_connection *c = conns.find(h.fd, h.generation))
         {
-            c->second.want_close = true;
+            c->want_close = true;
+            schedule_flush(*c);
         }
     }
 
+    void epoll_server::stop_reading_from_connection(std::shared_ptr<connection> conn)
+    {
+        if (epoll_connection *c = conns.find(conn->get_fd()))
+            c->read_stopped = true;
+    }
+
     void epoll_server::close_connection(int fd)
     {
-        auto c = conns.find(fd);
-        if (c == conns.end())
+        epoll_connection *found = conns.find(fd);
+        if (!found)
             return; // Connection already closed
-        conns[fd].want_close = true;
-        mod_epoll(fd, HAMZA_CUSTOM_CLOSE_EVENT);
+        epoll_connection &c = *found;
+        c.want_close = true;
+        schedule_flush(c);
     }
 
-    /**
-     * @brief Queues a message for asynchronous sending
-     *
-     * Adds a message to the connection's output queue and ensures the connection
-     * is monitored for write availability. Messages are sent asynchronously
-     * when the socket becomes writable, providing efficient flow control.
-     * Algorithm:
-     * 1. Find connection in internal map
-     * 2. Add message to connection's output queue
-     * 3. Enable write monitoring via epoll
-     * 4. Actual sending happens in main event loop
-     *
-     * Benefits:
-     * - Non-blocking message queuing
-     * - Automatic flow control via epoll
-     * - Prevents blocking on full socket buffers
-     * - Maintains message ordering per connection
-     */
-    void epoll_server::send_message(std::shared_ptr<connection> conn, const data_buffer &db)
+    void epoll_server::abort_connection(std::shared_ptr<connection> conn)
     {
-        int fd = conn->get_fd();
-        auto it = conns.find(fd);
-        if (it == conns.end())
-        {
-            return; // Connection not found
-        }
-        epoll_connection &c = it->second;
-        c.outq.emplace_back(db.to_string());
+        epoll_connection *found = conns.find(conn->get_fd());
+        if (!found)
+            return; // Connection already closed
+        abort_conn(*found);
+    }
 
-        // Enable write monitoring to flush the queue
-        mod_epoll(fd, EPOLLOUT);
+    void epoll_server::abort_conn(epoll_connection &c)
+    {
+        c.outq.clear();
+        c.out_offset = 0;
+        c.out_files.clear();
+        c.want_abort = true;
+        c.want_close = true;
+        schedule_flush(c);
     }
 
     // ============================================================================
-    // Virtual Callback Methods - Override Points for Derived Classes
+    // Cross-thread Commands
     // ============================================================================
 
-    /**
-     * Override Examples:
-     * - Log to file or syslog
-     * - Send error notifications
-     * - Implement circuit breaker patterns
-     * - Trigger failover mechanisms
-     */
-    void epoll_server::on_exception_occurred(const std::exception &e)
+    namespace
     {
-        std::cerr << "Exception: " << e.what() << std::endl;
+        /// Commands run per drain before I/O gets its turn again
+        constexpr std::size_t MAX_COMMANDS_PER_DRAIN = 1024;
+
+#if !(defined(__linux__) || defined(__linux))
+        /**
+         * wepoll has no eventfd: a non-blocking UDP socket connected to
+         * itself on loopback serves as the wakeup source instead. A wake
+         * sends it one byte, the drain reads everything queued.
+         */
+        int open_wake_socket()
+        {
+            SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (s == INVALID_SOCKET)
+                return -1;
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            int len = sizeof(addr);
+            u_long non_blocking = 1;
+            if (::bind(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+                ::getsockname(s, reinterpret_cast<sockaddr *>(&addr), &len) != 0 ||
+                ::connect(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+                ::ioctlsocket(s, FIONBIO, &non_blocking) != 0)
+            {
+                ::closesocket(s);
+                return -1;
+            }
+            return static_cast<int>(s);
+        }
+#endif
     }
 
-    void epoll_server::on_connection_opened(std::shared_ptr<connection> conn)
+    /**
+     * Wakeup Protocol:
+     * - A producer pushes its command, then sets wake_pending. Only the
+     *   producer that flips it from false writes the eventfd, so a burst of
+     *   posts costs one write and one epoll wakeup.
+     * - The loop clears wake_pending before draining. A command pushed
+     *   before the clear is seen by that drain; one pushed after it finds
+     *   the flag clear and wakes the loop again. Nothing is stranded.
+     */
+    void epoll_server::wake()
     {
-        std::cout << "Client Connected:\n";
-        std::cout << "\t Client " << conn->get_fd() << " connected." << std::endl;
+        if (wake_fd == -1 || wake_pending.exchange(true))
+            return;
+#if defined(__linux__) || defined(__linux)
+        uint64_t one = 1;
+        ssize_t r = ::write(wake_fd, &one, sizeof(one));
+        (void)r; // EAGAIN means the counter is already non-zero: the loop wakes anyway
+#else
+        char one = 1;
+        ::send(static_cast<SOCKET>(wake_fd), &one, 1, 0); // A full buffer means a wakeup is queued anyway
+#endif
     }
 
-    void epoll_server::on_connection_closed(std::shared_ptr<connection> conn)
+    void epoll_server::drain_commands()
+    {
+#if defined(__linux__) || defined(__linux)
+        uint64_t count;
+        ssize_t r = ::read(wake_fd, &count, sizeof(count));
+        (void)r;
+#else
+        char bytes[64];
+        while (::recv(static_cast<SOCKET>(wake_fd), bytes, sizeof(bytes), 0) > 0)
+        {
+        }
+#endif
+        wake_pending.store(false);
+
+        loop_command cmd;
+        std::size_t budget = MAX_COMMANDS_PER_DRAIN;
+        while (budget > 0 && commands.pop(cmd))
+        {
+            --budget;
+            try
+            {
+                run_command(cmd);
+            }
+            catch (const std::exception &e)
+            {
+                on_exception_occurred(e);
+            }
+            // Release the payload and captures now, not at the next pop
+            cmd = loop_command();
+        }
+        if (!commands.empty())
+            wake(); // Budget spent: finish on the next iteration, after I/O
+    }
+
+    void epoll_server::run_command(loop_command &cmd)
+    {
+        switch (cmd.type)
+        {
+        case loop_command::kind::send:
+            if (!conns.find(cmd.target.fd, cmd.target.generation) && forward_command(cmd))
+                break;
+            send_message(cmd.target, cmd.data);
+            break;
+        case loop_command::kind::close:
+            if (!conns.find(cmd.target.fd, cmd.target.generation) && forward_command(cmd))
+                break;
+            close_connection(cmd.target);
+            break;
+        case loop_command::kind::message:
+            if (conns.find(cmd.target.fd, cmd.target.generation))
+                on_message_received(cmd.target, cmd.data);
+            else
+                forward_command(cmd);
+            break;
+        case loop_command::kind::task:
+            cmd.task();
+            break;
+        case loop_command::kind::accept:
+            bump(load_handoffs, 1);
+            accept_conn(cmd.accepted, cmd.peer);
+            break;
+        }
+    }
+
+    void epoll_server::post_send(connection_handle h, data_buffer db)
+    {
+        loop_command cmd;
+        cmd.type = loop_command::kind::send;
+        cmd.target = h;
+        cmd.data = std::move(db);
+        commands.push(std::move(cmd));
+        wake();
+    }
+
+    void epoll_server::post_close(connection_handle h)
+    {
+        loop_command cmd;
+        cmd.type = loop_command::kind::close;
+        cmd.target = h;
+        commands.push(std::move(cmd));
+        wake();
+    }
+
+    void epoll_server::post(std::function<void()> task)
+    {
+        loop_command cmd;
+        cmd.task = std::move(task);
+        commands.push(std::move(cmd));
+        wake();
+    }
+
+    void epoll_server::post_accepted(int cfd, const sockaddr_storage &peer)
+    {
+        loop_command cmd;
+        cmd.type = loop_command::kind::accept;
+        cmd.accepted = cfd;
+        cmd.peer = peer;
+        commands.push(std::move(cmd));
+        wake();
+    }
+
+    // ============================================================================
+    // Worker Pool
+    // ============================================================================
+
+    /**
+     * The task captures the handle, not the connection: if the connection
+     * closes before the worker gets to it, the handler still runs, and its
+     * post_send() is a no-op. The in-flight count is decremented last,
+     * since wait_offloaded() lets the server be destroyed right after.
+     */
+    void epoll_server::offload_message(epoll_connection &c, const data_buffer &db)
+    {
+        if (!c.strand)
+            c.strand = workers->make_strand();
+        offloaded.fetch_add(1, std::memory_order_relaxed);
+        workers->submit(*c.strand, [this, h = handle_of(c), db]
+                        {
+            try
+            {
+                on_worker_message(h, db);
+            }
+            catch (const std::exception &e)
+            {
+                std::string what = e.what();
+                post([this, what]
+                     { on_exception_occurred(std::runtime_error(what)); });
+            }
+            offloaded.fetch_sub(1, std::memory_order_release); });
+    }
+
+    void epoll_server::on_worker_message(connection_handle h, const data_buffer &db)
+    {
+        loop_command cmd;
+        cmd.type = loop_command::kind::message;
+        cmd.target = h;
+        cmd.data = db;
+        commands.push(std::move(cmd));
+        wake();
+    }
+
+    void epoll_server::wait_offloaded()
+    {
+        while (offloaded.load(std::memory_order_acquire) > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // ============================================================================
+    // Connection Migration
+    // ============================================================================
+
+    loop_load epoll_server::get_load() const
+    {
+        loop_load load;
+        load.connections = load_connections.load(std::memory_order_relaxed);
+        load.events = load_events.load(std::memory_order_relaxed);
+        load.migrated_out = load_migrated_out.load(std::memory_order_relaxed);
+        load.migrated_in = load_migrated_in.load(std::memory_order_relaxed);
+        load.handoffs = load_handoffs.load(std::memory_order_relaxed);
+        load.truncated_datagrams = load_truncated.load(std::memory_order_relaxed);
+        return load;
+    }
+
+    /**
+     * The new loop runs the command through run_command() too, so a
+     * connection that moved again is followed further. Commands are
+     * forwarded after the adopt_connections() task this loop posted, from
+     * the same thread, so the new handle is set when they run.
+     */
+    bool epoll_server::forward_command(const loop_command &cmd)
+    {
+        auto it = forwards.find(cmd.target.fd);
+        if (it == forwards.end() || it->second.generation != cmd.target.generation)
+            return false;
+        epoll_server *to = it->second.target;
+        std::shared_ptr<connection_handle> handle = it->second.handle;
+        to->post([to, handle, moved = cmd]() mutable
+                 {
+            moved.target = *handle;
+            to->run_command(moved); });
+        return true;
+    }
+
+    bool epoll_server::can_migrate(const epoll_connection &c, uint64_t min_idle_ms) const
+    {
+        if (c.want_close || c.write_blocked || !c.zc_holds.empty())
+            return false;
+        if (c.strand && c.strand.use_count() > 1)
+            return false; // Scheduled on the pool: its replies target this loop
+        return loop_time - std::max(c.last_read, c.last_write) >= min_idle_ms;
+    }
+
+    /**
+     * Detach Steps (per connection):
+     * 1. on_connection_migrated_out(), while the handle still resolves
+     * 2. Remove the fd from this epoll set; the fd itself stays open
+     * 3. Cancel the deadline (the timer belongs to this loop's wheel) and
+     *    take the queued bytes and the per-IP count off this loop's totals
+     * 4. Move the state out of the table
+     *
+     * Candidates are picked before any callback runs, since callbacks may
+     * change the table.
+     */
+    std::size_t epoll_server::migrate_idle_connections(epoll_server &target, std::size_t max_count, std::chrono::milliseconds min_idle)
+    {
+        if (&target == this || max_count == 0 || !supports_migration() || !target.supports_migration())
+            return 0;
+        uint64_t min_idle_ms = static_cast<uint64_t>(min_idle.count());
+
+        std::vector<int> picked;
+        for (auto &&[fd, c] : conns)
+        {
+            if (picked.size() >= max_count)
+                break;
+            if (can_migrate(c, min_idle_ms))
+                picked.push_back(fd);
+        }
+
+        auto moving = std::make_shared<std::vector<epoll_connection>>();
+        auto handles = std::make_shared<std::vector<std::shared_ptr<connection_handle>>>();
+        moving->reserve(picked.size());
+        for (int fd : picked)
+        {
+            epoll_connection *c = conns.find(fd);
+            if (!c)
+                continue;
+            on_connection_migrated_out(handle_of(*c));
+            c = conns.find(fd);
+            if (!c || !can_migrate(*c, min_idle_ms))
+                continue; // The callback closed or used it
+
+            del_epoll(fd);
+            c->deadline.cancel();
+            std::size_t queued = c->out_bytes;
+            account_written(*c, queued);
+            c->out_bytes = queued;
+            if (c->ip_counted)
+                accept_limiter.release(c->conn->get_remote_address().get_ip_address());
+            c->ip_counted = false;
+            c->flush_pending = false;
+            c->strand.reset(); // Idle; the target may use another pool
+
+            // Commands other threads still post against the old handle follow the connection
+            migration_forward &fwd = forwards[fd];
+            fwd.generation = conns.generation(fd);
+            fwd.target = &target;
+            fwd.handle = std::make_shared<connection_handle>();
+            handles->push_back(fwd.handle);
+
+            moving->push_back(std::move(*c));
+            conns.erase(fd);
+            current_open_connections--;
+            load_connections.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (moving->empty())
+            return 0;
+
+        bump(load_migrated_out, moving->size());
+        epoll_server *to = &target;
+        target.post([to, moving, handles]
+                    { to->adopt_connections(*moving, *handles); });
+        return moving->size();
+    }
+
+    /**
+     * The fd is registered with the interest the old loop had. Adding an
+     * edge-triggered fd that is already readable or writable reports it at
+     * once, so nothing that arrived during the hand-over is missed.
+     */
+    void epoll_server::adopt_connections(std::vector<epoll_connection> &states,
+                                         const std::vector<std::shared_ptr<connection_handle>> &handles)
+    {
+        for (std::size_t i = 0; i < states.size(); ++i)
+        {
+            epoll_connection &state = states[i];
+            int fd = state.conn->get_fd();
+            forwards.erase(fd); // Moved back: this loop has it again
+            bool reused = false;
+            epoll_connection &c = conns.revive(fd, reused);
+            c = std::move(state);
+            current_open_connections++;
+            load_connections.fetch_add(1, std::memory_order_relaxed);
+            bump(load_migrated_in, 1);
+
+            *handles[i] = handle_of(c);
+            c.deadline.set_callback([this, fd]
+                                    { on_deadline(fd); });
+            total_out_bytes += c.out_bytes;
+            if (accept_limiter.active())
+            {
+                accept_limiter.track(c.conn->get_remote_address().get_ip_address(), loop_time);
+                c.ip_counted = true;
+            }
+
+            if (add_epoll(fd, (c.read_interest ? uint32_t(EPOLLIN) : 0u) | (c.want_write ? uint32_t(EPOLLOUT) : 0u) | EPOLLET) != 0)
+            {
+                int err = errno;
+                close_conn(fd);
+                on_exception_occurred(std::runtime_error("epoll_ctl ADD migrated conn error: " + std::string(strerror(err))));
+                continue;
+            }
+            arm_deadline(c);
+            if (c.has_output())
+                schedule_flush(c);
+            on_connection_migrated_in(handle_of(c));
+        }
+    }
+
+    // ============================================================================
+    // Timers and Connection Deadlines
+    // ============================================================================
+
+    void epoll_server::run_timers()
+    {
+        timers.advance(loop_time);
+        retired_timers.clear();
+    }
+
+    void epoll_server::arm_deadline(epoll_connection &c)
+    {
+        uint64_t next = UINT64_MAX;
+        if (c.idle_timeout)
+            next = std::min(next, std::max(c.last_read, c.last_write) + c.idle_timeout);
+        if (c.read_timeout && !c.read_stopped)
+            next = std::min(next, c.last_read + c.read_timeout);
+        if (c.write_timeout && (c.has_output() || !c.zc_holds.empty()))
+            next = std::min(next, c.last_write + c.write_timeout);
+
+        if (next == UINT64_MAX)
+            c.deadline.cancel();
+        else if (!c.deadline.armed() || c.deadline.expiry() != next)
+            timers.schedule_at(c.deadline, next);
+    }
+
+    /**
+     * Check Order:
+     * 1. Write: output is queued and made no progress for write_timeout
+     * 2. Read: nothing was received for read_timeout
+     * 3. Idle: nothing was received or sent for idle_timeout
+     *
+     * The expired deadline's reference time is reset before the callback, so
+     * an override that keeps the connection open gets another full period.
+     * Nothing is closed synchronously here: close_connection() and
+     * abort_connection() only mark the connection for the flush pass, which
+     * keeps the running timer alive until the wheel is done with it.
+     */
+    void epoll_server::on_deadline(int fd)
+    {
+        epoll_connection *found = conns.find(fd);
+        if (!found)
+            return;
+        epoll_connection &c = *found;
+        uint64_t now = timers.now();
+
+        bool expired = true;
+        timeout_kind kind = timeout_kind::idle;
+        if (c.write_timeout && (c.has_output() || !c.zc_holds.empty()) && now >= c.last_write + c.write_timeout)
+        {
+            kind = timeout_kind::write;
+            c.last_write = now;
+        }
+        else if (c.read_timeout && !c.read_stopped && now >= c.last_read + c.read_timeout)
+        {
+            kind = timeout_kind::read;
+            c.last_read = now;
+        }
+        else if (c.idle_timeout && now >= std::max(c.last_read, c.last_write) + c.idle_timeout)
+        {
+            kind = timeout_kind::idle;
+            c.last_read = c.last_write = now;
+        }
+        else
+            expired = false; // Activity moved the deadline, fire later
+
+        arm_deadline(c);
+        if (expired && !c.want_close)
+            on_connection_timeout(c.conn, kind);
+    }
+
+    void epoll_server::on_connection_timeout(std::shared_ptr<connection> conn, timeout_kind kind)
+    {
+        if (kind == timeout_kind::write)
+            abort_connection(conn); // The peer is not reading, flushing would never finish
+        else
+            close_connection(conn);
+    }
+
+    void epoll_server::set_connection_timeouts(std::shared_ptr<connection> conn, std::chrono::milliseconds idle,
+                                               std::chrono::milliseconds read, std::chrono::milliseconds write)
+    {
+        epoll_connection *found = conns.find(conn->get_fd());
+        if (!found)
+            return;
+        epoll_connection &c = *found;
+        c.idle_timeout = static_cast<uint32_t>(idle.count());
+        c.read_timeout = static_cast<uint32_t>(read.count());
+        c.write_timeout = static_cast<uint32_t>(write.count());
+        arm_deadline(c);
+    }
+
+    // ============================================================================
+    // UDP Endpoints
+    // ============================================================================
+
+    /**
+     * Algorithm:
+     * 1. One recvmmsg() fills up to 64 slots of the endpoint's batch
+     * 2. Each payload is copied into the loop's receive block, so the
+     *    callback gets a data_buffer slice that can be kept or queued for
+     *    sending like received TCP data, while the batch slots are reused
+     * 3. A batch that came back less than full means the receive queue is
+     *    empty; the next datagram raises a new edge, so no extra call is
+     *    spent to hit EAGAIN
+     *
+     * A receive error (typically an ICMP error reported on the socket) is
+     * consumed by the failing call, so reading simply continues. The
+     * callback may unregister the endpoint; the slot generation detects it.
+     */
+    void epoll_server::try_read_datagrams(udp_endpoint &u)
+    {
+        std::shared_ptr<socket> sock = u.sock;
+        int fd = sock->get_fd();
+        uint32_t generation = udp_endpoints.generation(fd);
+        bool failed = false;
+
+        while (true)
+        {
+            std::size_t n;
+            try
+            {
+                n = sock->receive_batch(u.in);
+                failed = false;
+            }
+            catch (const std::exception &e)
+            {
+                if (failed)
+                    return; // Error persists: wait for the next edge
+                failed = true;
+                on_exception_occurred(e);
+                continue;
+            }
+
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (u.in.truncated(i))
+                {
+                    // The tail is gone: a cut-short payload would look like a whole one
+                    bump(load_truncated, 1);
+                    continue;
+                }
+                std::size_t len = u.in.length(i);
+                if (prepare_read_block() < len)
+                {
+                    read_block = recv_pool.acquire();
+                    read_used = 0;
+                }
+                std::memcpy(&(*read_block)[read_used], u.in.data(i), len);
+                data_buffer db(read_block, read_used, len);
+                read_used += len;
+
+                on_datagram(sock, u.in.peer(i), db);
+                if (!udp_endpoints.find(fd, generation))
+                    return; // Unregistered by the callback
+            }
+
+            if (n < u.in.capacity())
+                return;
+        }
+    }
+
+    /**
+     * Algorithm (Linux):
+     * 1. Point up to 64 mmsghdr/iovec pairs at the queued datagrams
+     *    (destination and payload are referenced, not copied)
+     * 2. One sendmmsg(); pop the datagrams it sent
+     * 3. EAGAIN: leave the rest queued, EPOLLOUT (always registered,
+     *    edge-triggered) resumes the flush
+     * 4. Any other error refers to the first unsent datagram: drop it
+     */
+    void epoll_server::flush_datagrams(udp_endpoint &u)
+    {
+        int fd = u.sock->get_fd();
+        while (!u.outq.empty())
+        {
+#if defined(__linux__) || defined(__linux)
+            const std::size_t max_batch = 64;
+            mmsghdr msgs[max_batch];
+            iovec iov[max_batch];
+            std::size_t count = std::min(max_batch, u.outq.size());
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                udp_datagram &d = u.outq[i];
+                iov[i].iov_base = const_cast<char *>(d.data.data());
+                iov[i].iov_len = d.data.size();
+                msgs[i] = mmsghdr{};
+                msgs[i].msg_hdr.msg_name = d.to.get_sock_addr();
+                msgs[i].msg_hdr.msg_namelen = d.to.get_sock_addr_len();
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            int n = ::sendmmsg(fd, msgs, static_cast<unsigned>(count), 0);
+#else
+            udp_datagram &d = u.outq.front();
+            int n = ::sendto(fd, d.data.data(), static_cast<int>(d.data.size()), 0,
+                             d.to.get_sock_addr(), d.to.get_sock_addr_len()) < 0
+                        ? -1
+                        : 1;
+#endif
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return; // Socket buffer full: EPOLLOUT resumes
+                n = 1;      // The first datagram was rejected, drop it
+            }
+            u.outq.erase(u.outq.begin(), u.outq.begin() + n);
+        }
+    }
+
+    bool epoll_server::send_datagram(std::shared_ptr<socket> sock, const socket_address &to, const data_buffer &data)
+    {
+        if (!sock)
+            return false;
+        int fd = sock->get_fd();
+        udp_endpoint *u = udp_endpoints.find(fd);
+        if (!u || u->outq.size() >= UDP_QUEUE_LIMIT)
+            return false;
+
+        u->outq.push_back(udp_datagram{to, data});
+        if (!u->flush_pending)
+        {
+            u->flush_pending = true;
+            udp_pending.push_back(fd);
+        }
+        return true;
+    }
+
+    /**
+     * The socket is registered for EPOLLIN and EPOLLOUT once, edge-triggered:
+     * an idle UDP socket is always writable, so EPOLLOUT only fires again
+     * after a send hit EAGAIN and space was freed.
+     */
+    bool epoll_server::register_udp_socket(std::shared_ptr<socket> sock_ptr, std::size_t datagram_size)
+    {
+        if (!sock_ptr)
+            return false;
+        try
+        {
+            sock_ptr->set_non_blocking(true);
+        }
+        catch (const std::exception &e)
+        {
+            on_exception_occurred(e);
+            return false;
+        }
+
+        int fd = sock_ptr->get_fd();
+        // A datagram must fit in one receive block
+        datagram_size = std::max<std::size_t>(1, std::min(datagram_size, recv_pool.block_size()));
+        udp_endpoints.emplace(fd, sock_ptr, datagram_size);
+        if (add_epoll(fd, EPOLLIN | EPOLLOUT | EPOLLET) != 0)
+        {
+            udp_endpoints.erase(fd);
+            return false;
+        }
+        return true;
+    }
+
+    void epoll_server::unregister_udp_socket(std::shared_ptr<socket> sock_ptr)
+    {
+        if (!sock_ptr)
+            return;
+        int fd = sock_ptr->get_fd();
+        if (udp_endpoints.erase(fd))
+            del_epoll(fd);
+    }
+
+    // ============================================================================
+    // MSG_ZEROCOPY
+    // ============================================================================
+
+    bool epoll_server::enable_zerocopy(epoll_connection &c)
+    {
+#if defined(__linux__) || defined(__linux)
+        if (c.zerocopy == 0)
+        {
+            int one = 1;
+            c.zerocopy = ::setsockopt(c.conn->get_fd(), SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0 ? 1 : -1;
+        }
+        return c.zerocopy > 0;
+#else
+        c.zerocopy = -1;
+        return false;
+#endif
+    }
+
+    /**
+     * Notification Format:
+     * - One recvmsg(MSG_ERRQUEUE) returns a sock_extended_err with origin
+     *   SO_EE_ORIGIN_ZEROCOPY covering the send sequence range
+     *   [ee_info, ee_data]; consecutive completions are coalesced
+     * - SO_EE_CODE_ZEROCOPY_COPIED in ee_code means the kernel copied the
+     *   data after all (no NIC support, loopback, ...)
+     *
+     * Sends complete in order, so every hold up to ee_data is released.
+     * A zerocopy-only EPOLLERR leaves SO_ERROR at 0, which tells it apart
+     * from a real socket error.
+     */
+    bool epoll_server::drain_zerocopy(epoll_connection &c)
+    {
+#if defined(__linux__) || defined(__linux)
+        int fd = c.conn->get_fd();
+        while (true)
+        {
+            char control[128];
+            msghdr msg{};
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+                break; // EAGAIN: queue drained
+
+            for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+            {
+                if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                      (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+                    continue;
+                auto *err = reinterpret_cast<sock_extended_err *>(CMSG_DATA(cm));
+                if (err->ee_origin != SO_EE_ORIGIN_ZEROCOPY || err->ee_errno != 0)
+                    continue;
+
+                uint64_t sends = static_cast<uint32_t>(err->ee_data - err->ee_info) + 1ULL;
+                if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                    zc_stats.copied += sends;
+                else
+                    zc_stats.completed += sends;
+                while (!c.zc_holds.empty() && static_cast<int32_t>(c.zc_holds.front().seq - err->ee_data) <= 0)
+                    c.zc_holds.pop_front();
+            }
+        }
+        c.last_write = loop_time;
+
+        int so_error = 0;
+        socklen_t len = sizeof(so_error);
+        ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+        return so_error == 0;
+#else
+        return false;
+#endif
+    }
+
+    // ============================================================================
+    // Output Watermarks
+    // ============================================================================
+
+    /**
+     * A connection is blocked when its own queue exceeds its high watermark,
+     * or when it queues output while the loop-wide total is over the global
+     * high watermark. Blocking only sets a flag: try_read() stops at once and
+     * EPOLLIN is dropped by the flush pass that send_message() schedules.
+     */
+    void epoll_server::account_queued(epoll_connection &c, std::size_t n)
+    {
+        c.out_bytes += n;
+        total_out_bytes += n;
+        if (global_high_watermark && total_out_bytes > global_high_watermark)
+            global_blocked = true;
+
+        if (c.write_blocked)
+            return;
+        if (global_blocked || (c.high_watermark && c.out_bytes > c.high_watermark))
+        {
+            c.write_blocked = true;
+            on_write_blocked(c.conn);
+        }
+    }
+
+    /**
+     * Blocked connections may have nothing left to write, so no flush of
+     * their own would notice the global drain; they are all scheduled for a
+     * flush pass here instead. This walk only happens once per global
+     * high/low cycle.
+     */
+    void epoll_server::account_written(epoll_connection &c, std::size_t n)
+    {
+        c.out_bytes -= n;
+        total_out_bytes -= n;
+        if (global_blocked && total_out_bytes <= global_low_watermark)
+        {
+            global_blocked = false;
+            for (auto &&[fd, other] : conns)
+                if (other.write_blocked)
+                    schedule_flush(other);
+        }
+    }
+
+    bool epoll_server::release_write_block(epoll_connection &c)
+    {
+        if (global_blocked || (c.high_watermark && c.out_bytes > c.low_watermark))
+            return false;
+        c.write_blocked = false;
+        return true;
+    }
+
+    void epoll_server::set_connection_write_watermarks(std::shared_ptr<connection> conn, std::size_t high, std::size_t low)
+    {
+        epoll_connection *found = conns.find(conn->get_fd());
+        if (!found)
+            return;
+        found->high_watermark = high;
+        found->low_watermark = std::min(low, high);
+        if (found->write_blocked)
+            schedule_flush(*found); // May resume under the new marks
+    }
+
+    void epoll_server::set_write_watermarks(std::size_t high, std::size_t low)
+    {
+        default_high_watermark = high;
+        default_low_watermark = std::min(low, high);
+    }
+
+    void epoll_server::set_global_write_watermarks(std::size_t high, std::size_t low)
+    {
+        global_high_watermark = high;
+        global_low_watermark = std::min(low, high);
+    }
+
+    void epoll_server::set_idle_timeout(std::chrono::milliseconds timeout)
+    {
+        default_idle_timeout = static_cast<uint32_t>(timeout.count());
+    }
+
+    void epoll_server::set_read_timeout(std::chrono::milliseconds timeout)
+    {
+        default_read_timeout = static_cast<uint32_t>(timeout.count());
+    }
+
+    void epoll_server::set_write_timeout(std::chrono::milliseconds timeout)
+    {
+        default_write_timeout = static_cast<uint32_t>(timeout.count());
+    }
+
+    /**
+     * A one-shot timer retires itself before running the function, so the
+     * function may schedule or cancel timers (including its own id) freely.
+     */
+    epoll_server::timer_id epoll_server::schedule_after(std::chrono::milliseconds delay, std::function<void()> fn)
+    {
+        timer_id id = next_timer_id++;
+        auto t = std::make_unique<timer>([this, id, fn = std::move(fn)]
+                                         {
+            auto it = user_timers.find(id);
+            if (it != user_timers.end())
+            {
+                retired_timers.push_back(std::move(it->second));
+                user_timers.erase(it);
+            }
+            fn(); });
+        timers.schedule(*t, static_cast<uint64_t>(std::max<std::chrono::milliseconds::rep>(delay.count(), 0)));
+        user_timers.emplace(id, std::move(t));
+        return id;
+    }
+
+    epoll_server::timer_id epoll_server::schedule_every(std::chrono::milliseconds period, std::function<void()> fn)
+    {
+        timer_id id = next_timer_id++;
+        auto t = std::make_unique<timer>(std::move(fn));
+        timers.schedule_every(*t, static_cast<uint64_t>(std::max<std::chrono::milliseconds::rep>(period.count(), 1)));
+        user_timers.emplace(id, std::move(t));
+        return id;
+    }
+
+    bool epoll_server::cancel_timer(timer_id id)
+    {
+        auto it = user_timers.find(id);
+        if (it == user_timers.end())
+            return false;
+        it->second->cancel();
+        // Freed after the wheel pass: this may be the timer that is running
+        retired_timers.push_back(std::move(it->second));
+        user_timers.erase(it);
+        return true;
+    }
+
+    /**
+     * @brief Queues a message for asynchronous sending
+     *
+     * Adds a message to the connection's output queue and schedules the
+     * connection to be flushed before the loop waits again. Messages are sent
+     * asynchronously, so several messages queued in one callback leave in a
+     * single gathered write.
+     * Algorithm:
+     * 1. Find connection in internal map
+     * 2. Add message to connection's output queue
+     * 3. Schedule the connection for the pending-write pass (no syscall)
+     * 4. Actual sending happens in main event loop
+     *
+     * Benefits:
+     * - Non-blocking message queuing
+     * - Automatic flow control via epoll
+     * - Prevents blocking on full socket buffers
+     * - Maintains message ordering per connection
+     */
+    void epoll_server::send_message(std::shared_ptr<connection> conn, const data_buffer &db)
+    {
+        send_message(*conn, db);
+    }
+
+    void epoll_server::send_message(const connection &conn, const data_buffer &db)
+    {
+        if (epoll_connection *c = conns.find(conn.get_fd()))
+            queue_message(*c, db);
+    }
+
+    /**
+     * The generation check makes a handle of a closed connection miss even
+     * when its fd already belongs to a new connection.
+     */
+    void epoll_server::send_message(connection_handle h, const data_buffer &db)
+    {
+        if (epoll_connection *c = conns.find(h.fd, h.generation))
+            queue_message(*c, db);
+    }
+
+    void epoll_server::queue_message(epoll_connection &c, const data_buffer &db)
+    {
+        if (db.empty() || c.want_abort)
+            return;
+
+        // The write deadline counts from the moment output starts waiting
+        bool was_idle = !c.has_output();
+        if (was_idle)
+            c.last_write = loop_time;
+        c.outq.push_back(db); // shares the bytes, no copy
+        c.out_queued += db.size();
+        if (was_idle && c.write_timeout)
+            arm_deadline(c);
+        account_queued(c, db.size());
+
+        // A connection waiting for EPOLLOUT is flushed by that event
+        if (!c.want_write)
+            schedule_flush(c);
+    }
+
+    /**
+     * Ordering:
+     * - outq holds only memory buffers; file segments wait in out_files with
+     *   the output stream position of their first byte
+     * - The write path sends buffers up to the next segment's position, then
+     *   the segment, then continues with the buffers queued after it
+     *
+     * The memory path therefore stays a plain gathered sendmsg(), and a file
+     * costs one duplicated descriptor plus sendfile() calls.
+     */
+    void epoll_server::send_file(std::shared_ptr<connection> conn, int file_fd, uint64_t offset, std::size_t length)
+    {
+        epoll_connection *found = conns.find(conn->get_fd());
+        if (!found)
+            return; // Connection not found
+        epoll_connection &c = *found;
+        if (length == 0 || c.want_abort)
+            return;
+
+#if defined(__linux__) || defined(__linux)
+        int dup_fd = ::fcntl(file_fd, F_DUPFD_CLOEXEC, 0);
+        if (dup_fd < 0)
+            throw socket_exception("Failed to duplicate file descriptor: " + std::string(strerror(errno)), "SendFile", __func__);
+
+        file_segment seg;
+        seg.file = std::shared_ptr<file_descriptor>(new file_descriptor(dup_fd), close_file);
+        seg.offset = offset;
+        seg.remaining = length;
+        seg.stream_pos = c.out_queued;
+
+        bool was_idle = !c.has_output();
+        if (was_idle)
+            c.last_write = loop_time;
+        c.out_files.push_back(std::move(seg));
+        c.out_queued += length;
+        if (was_idle && c.write_timeout)
+            arm_deadline(c);
+
+        if (!c.want_write)
+            schedule_flush(c);
+#else
+        // No sendfile: read the range and queue it as a regular message
+        std::string bytes(length, '\0');
+        if (_lseeki64(file_fd, static_cast<__int64>(offset), SEEK_SET) < 0)
+            throw socket_exception("Failed to seek file: " + std::string(strerror(errno)), "SendFile", __func__);
+        std::size_t got = 0;
+        while (got < length)
+        {
+            int n = _read(file_fd, &bytes[got], static_cast<unsigned>(std::min<std::size_t>(length - got, INT_MAX)));
+            if (n <= 0)
+                throw socket_exception("Failed to read file range", "SendFile", __func__);
+            got += static_cast<std::size_t>(n);
+        }
+        send_message(conn, data_buffer(std::move(bytes)));
+#endif
+    }
+
+    /**
+     * Algorithm:
+     * 1. sendfile() from the segment's offset, at most 2GB per call
+     * 2. Advance the segment and the output stream position by what was sent
+     * 3. Stop on a short write (socket buffer full) or EAGAIN
+     * 4. Pop the segment once it is complete
+     *
+     * sendfile() returning 0 means the file ended before the segment did.
+     */
+    bool epoll_server::flush_file(epoll_connection &c)
+    {
+#if defined(__linux__) || defined(__linux)
+        int fd = c.conn->get_fd();
+        file_segment &seg = c.out_files.front();
+        while (seg.remaining > 0)
+        {
+            std::size_t chunk = std::min<std::size_t>(seg.remaining, 0x7ffff000);
+            off_t off = static_cast<off_t>(seg.offset);
+            ssize_t n = ::sendfile(fd, seg.file->get(), &off, chunk);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return false;
+            }
+            if (n <= 0)
+            {
+                // Read error or truncated file: the promised bytes can never be sent
+                abort_conn(c);
+                return true;
+            }
+            std::size_t sent = static_cast<std::size_t>(n);
+            seg.offset += sent;
+            seg.remaining -= sent;
+            seg.stream_pos += sent;
+            c.out_written += sent;
+            c.last_write = loop_time;
+            if (sent < chunk)
+                return false; // Socket buffer is full
+        }
+        c.out_files.pop_front();
+        return true;
+#else
+        // send_file() never queues segments without sendfile
+        c.out_files.pop_front();
+        return true;
+#endif
+    }
+
+    // ============================================================================
+    // Virtual Callback Methods - Override Points for Derived Classes
+    // ============================================================================
+
+    /**
+     * Override Examples:
+     * - Log to file or syslog
+     * - Send error notifications
+     * - Implement circuit breaker patterns
+     * - Trigger failover mechanisms
+     */
+    void epoll_server::on_exception_occurred(const std::exception &e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    void epoll_server::on_connection_opened(std::shared_ptr<connection> conn)
+    {
+        std::cout << "Client Connected:\n";
+        std::cout << "\t Client " << conn->get_fd() << " connected." << std::endl;
+    }
+
+    /**
+     * The handle overloads are what the loop calls; their defaults bridge to
+     * the shared_ptr callbacks so existing servers keep working unchanged.
+     */
+    void epoll_server::on_connection_opened(connection_handle h)
+    {
+        if (epoll_connection *c = conns.find(h.fd, h.generation))
+            on_connection_opened(c->conn);
+    }
+
+    void epoll_server::on_connection_closed(connection_handle h)
+    {
+        if (epoll_connection *c = conns.find(h.fd, h.generation))
+            on_connection_closed(c->conn);
+    }
+
+    void epoll_server::on_message_received(connection_handle h, const data_buffer &db)
+    {
+        if (epoll_connection *c = conns.find(h.fd, h.generation))
+            on_message_received(c->conn, db);
+    }
+
+    void epoll_server::on_connection_closed(std::shared_ptr<connection> conn)
+    {
+        std::cout << "Client Disconnected:\n";
+        std::cout << "\t Client " << conn->get_fd() << " disconnected." << std::endl;
+    }
+
+    void epoll_server::on_connection_migrated_out(connection_handle)
+    {
+    }
+
+    void epoll_server::on_connection_migrated_in(connection_handle)
     {
-        std::cout << "Client Disconnected:\n";
-        std::cout << "\t Client " << conn->get_fd() << " disconnected." << std::endl;
     }
 
     /**
@@ -559,7 +1819,10 @@ namespace hh_socket
      */
     void epoll_server::on_listen_success()
     {
-        std::cout << "Listening on " << listener_socket->get_fd() << std::endl;
+        if (listener_socket)
+            std::cout << "Listening on " << listener_socket->get_fd() << std::endl;
+        else
+            std::cout << "Event loop running without a listener" << std::endl;
     }
 
     /**
@@ -595,6 +1858,7 @@ namespace hh_socket
         else
 
             this->max_fds = max_fds;
+        conns.reserve(this->max_fds);
         events = std::vector<epoll_event>(4096);
         epoll_fd = epoll_create1(EPOLL_CLOEXEC);
         if (epoll_fd == -1)
@@ -602,6 +1866,15 @@ namespace hh_socket
             std::cerr << "Failed to create epoll instance: " << strerror(errno) << std::endl;
             throw std::runtime_error("Failed to create epoll instance");
         }
+        wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd == -1 || add_epoll(wake_fd, EPOLLIN) != 0)
+        {
+            std::cerr << "Failed to create wakeup eventfd: " << strerror(errno) << std::endl;
+            if (wake_fd != -1)
+                ::close(wake_fd);
+            close_socket(epoll_fd);
+            throw std::runtime_error("Failed to create wakeup eventfd");
+        }
 #else
         events = std::vector<epoll_event>(4096);
         epoll_fd = epoll_create1(0);
@@ -610,6 +1883,15 @@ namespace hh_socket
             std::cerr << "Failed to create epoll instance: " << strerror(errno) << std::endl;
             throw std::runtime_error("Failed to create epoll instance");
         }
+        wake_fd = open_wake_socket();
+        if (wake_fd == -1 || add_epoll(wake_fd, EPOLLIN) != 0)
+        {
+            std::cerr << "Failed to create wakeup socket" << std::endl;
+            if (wake_fd != -1)
+                close_socket(static_cast<socket_t>(wake_fd));
+            epoll_close(epoll_fd);
+            throw std::runtime_error("Failed to create wakeup socket");
+        }
 #endif
     }
 
@@ -653,25 +1935,35 @@ namespace hh_socket
      */
     void epoll_server::stop_server()
     {
-        g_stop = 1;
+        g_stop = true;
+        wake();
     }
 
     /**
 
      * Cleanup Order:
      * 1. Close all active client connections
-     * 2. Close listener socket if present
-     * 3. Close epoll file descriptor
+     * 2. Close sockets still queued by post_accepted()
+     * 3. Close listener socket if present
+     * 4. Close epoll file descriptor
      */
     epoll_server::~epoll_server()
     {
-        for (auto &[fd, _] : conns)
-            close_socket(fd);
+        for (auto &&[fd, c] : conns)
+            c.conn->close();
+        // Sockets handed over after the loop stopped have no connection to close them
+        loop_command cmd;
+        while (commands.pop(cmd))
+            if (cmd.type == loop_command::kind::accept)
+                close_socket(cmd.accepted);
         if (listener_socket)
-            close_socket(listener_socket->get_fd());
+            listener_socket->disconnect();
 #if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
-        // hell nothing;
+        if (wake_fd != -1)
+            close_socket(static_cast<socket_t>(wake_fd));
 #else
+        if (wake_fd != -1)
+            ::close(wake_fd);
         if (epoll_fd != -1)
             close_socket(epoll_fd);
 #endif
@@ -0,0 +1,314 @@
+/**
+ * @file epoll_server_group.cpp
+ * @brief Implementation of the multi-reactor epoll_server_group
+ *
+ * Each loop is a fully independent epoll_server; the group only creates the
+ * SO_REUSEPORT listeners and the threads. No state is shared between loops,
+ * so there is no locking anywhere on the hot path. Optional rebalancing
+ * reads the loops' atomic load counters and moves connections through
+ * their command queues; the optional acceptor thread hands sockets to the
+ * loops through the same queues.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__) || defined(__linux)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "../includes/epoll_server_group.hpp"
+#include "../includes/exceptions.hpp"
+#include "../includes/utilities.hpp"
+
+namespace hh_socket
+{
+    epoll_server_group::epoll_server_group(std::size_t loop_count, const server_factory &make_loop)
+    {
+        if (loop_count == 0)
+            loop_count = std::thread::hardware_concurrency();
+        if (loop_count == 0)
+            loop_count = 1; // hardware_concurrency() may be unknown
+
+        loops.reserve(loop_count);
+        for (std::size_t i = 0; i < loop_count; ++i)
+        {
+            auto loop = make_loop();
+            if (!loop)
+            {
+                throw socket_exception("Server factory returned a null server", "ServerGroupCreation", __func__);
+            }
+            loops.push_back(std::move(loop));
+        }
+    }
+
+    /**
+     * Every loop gets its own listener bound to the same address with
+     * SO_REUSEPORT, so the kernel load-balances new connections between the
+     * loops' accept queues instead of waking every loop on one shared queue.
+     */
+    bool epoll_server_group::register_listener(uint16_t port, const std::string &ip, int backlog)
+    {
+        for (auto &loop : loops)
+        {
+            auto listener = make_listener_socket(port, ip, backlog, true);
+            if (!loop->register_listener_socket(listener))
+                return false;
+        }
+        return true;
+    }
+
+    bool epoll_server_group::register_acceptor(uint16_t port, const std::string &ip, int backlog, acceptor_policy policy)
+    {
+#if defined(__linux__) || defined(__linux)
+        if (acceptor_socket)
+            return false;
+        acceptor_stop_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (acceptor_stop_fd == -1)
+            return false;
+        acceptor_socket = make_listener_socket(port, ip, backlog);
+        accept_policy = policy;
+        handed.assign(loops.size(), 0);
+        return true;
+#else
+        // The acceptor thread needs eventfd, poll and accept4
+        (void)port;
+        (void)ip;
+        (void)backlog;
+        (void)policy;
+        return false;
+#endif
+    }
+
+    /**
+     * A loop's connection count lags behind the sockets still queued for
+     * it, so a burst would all go to the same loop. The estimate adds the
+     * sockets handed to a loop that it has not taken yet.
+     */
+    std::size_t epoll_server_group::pick_loop()
+    {
+        std::size_t n = loops.size();
+        if (accept_policy == acceptor_policy::round_robin)
+            return next_loop++ % n;
+
+        std::size_t best = 0;
+        uint64_t best_count = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            loop_load load = loops[i]->get_load();
+            uint64_t in_flight = handed[i] > load.handoffs ? handed[i] - load.handoffs : 0;
+            uint64_t count = load.connections + in_flight;
+            if (i == 0 || count < best_count)
+            {
+                best = i;
+                best_count = count;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * The listener is non-blocking: each wakeup accepts until EAGAIN. An
+     * error such as EMFILE leaves the connection in the backlog, so the
+     * thread backs off briefly instead of spinning on a readable listener.
+     */
+    void epoll_server_group::run_acceptor()
+    {
+#if defined(__linux__) || defined(__linux)
+        pollfd fds[2];
+        fds[0].fd = acceptor_socket->get_fd();
+        fds[0].events = POLLIN;
+        fds[1].fd = acceptor_stop_fd;
+        fds[1].events = POLLIN;
+
+        while (true)
+        {
+            fds[0].revents = fds[1].revents = 0;
+            if (::poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                std::cerr << "acceptor poll failed: " << strerror(errno) << std::endl;
+                return;
+            }
+            if (fds[1].revents)
+                return;
+
+            while (true)
+            {
+                sockaddr_storage peer{};
+                socklen_t peer_len = sizeof(peer);
+                int cfd = ::accept4(fds[0].fd, reinterpret_cast<sockaddr *>(&peer), &peer_len,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (cfd == -1)
+                {
+                    if (errno == EINTR || errno == ECONNABORTED)
+                        continue;
+                    if (errno != EAGAIN && errno != EWOULDBLOCK)
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    break;
+                }
+                std::size_t index = pick_loop();
+                ++handed[index];
+                loops[index]->post_accepted(cfd, peer);
+            }
+        }
+#endif
+    }
+
+    void epoll_server_group::stop_acceptor()
+    {
+#if defined(__linux__) || defined(__linux)
+        if (acceptor_stop_fd != -1)
+        {
+            uint64_t one = 1;
+            ssize_t r = ::write(acceptor_stop_fd, &one, sizeof(one));
+            (void)r;
+        }
+#endif
+    }
+
+    void epoll_server_group::set_ip_filter(const std::shared_ptr<ip_filter> &filter)
+    {
+        for (auto &loop : loops)
+            loop->set_ip_filter(filter);
+    }
+
+    void epoll_server_group::set_ip_limits(const ip_limits &limits)
+    {
+        for (auto &loop : loops)
+            loop->set_ip_limits(limits);
+    }
+
+    void epoll_server_group::set_worker_pool(const std::shared_ptr<worker_pool> &pool)
+    {
+        for (auto &loop : loops)
+            loop->set_worker_pool(pool);
+    }
+
+    void epoll_server_group::set_rebalancing(const rebalance_options &options)
+    {
+        balance = options;
+    }
+
+    void epoll_server_group::rebalance()
+    {
+        std::size_t n = loops.size();
+        if (n < 2)
+            return;
+        last_events.resize(n, 0);
+
+        std::vector<loop_load> loads(n);
+        std::vector<uint64_t> rate(n);
+        uint64_t total = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            loads[i] = loops[i]->get_load();
+            rate[i] = loads[i].events - last_events[i];
+            last_events[i] = loads[i].events;
+            total += rate[i];
+        }
+
+        std::size_t hot = 0, cold = 0;
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            if (rate[i] > rate[hot])
+                hot = i;
+            if (rate[i] < rate[cold] || (rate[i] == rate[cold] && loads[i].connections < loads[cold].connections))
+                cold = i;
+        }
+        double average = static_cast<double>(total) / static_cast<double>(n);
+        if (hot == cold || rate[hot] == 0 || static_cast<double>(rate[hot]) < average * balance.imbalance)
+            return;
+        if (loads[hot].connections <= loads[cold].connections)
+            return; // Moving idle connections would not spread future load
+        std::size_t moves = std::min(balance.max_moves, (loads[hot].connections - loads[cold].connections) / 2);
+        if (moves == 0)
+            return;
+
+        epoll_server *from = loops[hot].get();
+        epoll_server *to = loops[cold].get();
+        std::chrono::milliseconds min_idle = balance.min_idle;
+        from->post([from, to, moves, min_idle]
+                   { from->migrate_idle_connections(*to, moves, min_idle); });
+    }
+
+    /**
+     * Loops 1..N-1 run on their own threads, loop 0 runs on the caller's
+     * thread. When loop 0 returns (stop requested or fatal error) the other
+     * loops are told to stop as well and joined.
+     */
+    void epoll_server_group::listen(int timeout)
+    {
+        if (balance.interval.count() > 0 && balance_timer == 0 && loops.size() > 1)
+        {
+            // Timers are armed on the loop thread: post, run once loop 0 starts
+            epoll_server *first = loops[0].get();
+            first->post([this, first]
+                        { balance_timer = first->schedule_every(balance.interval, [this]
+                                                                { rebalance(); }); });
+        }
+
+        for (std::size_t i = 1; i < loops.size(); ++i)
+        {
+            epoll_server *loop = loops[i].get();
+            threads.emplace_back([loop, timeout]
+                                 { loop->listen(timeout); });
+        }
+
+#if defined(__linux__) || defined(__linux)
+        // Sockets posted before a loop starts wait in its queue
+        if (acceptor_socket && !acceptor_thread.joinable())
+        {
+            uint64_t stale;
+            while (::read(acceptor_stop_fd, &stale, sizeof(stale)) > 0)
+            {
+            }
+            acceptor_thread = std::thread([this]
+                                          { run_acceptor(); });
+        }
+#endif
+
+        loops[0]->listen(timeout);
+
+        stop_server();
+        if (acceptor_thread.joinable())
+            acceptor_thread.join();
+        for (auto &t : threads)
+            t.join();
+        threads.clear();
+    }
+
+    /**
+     * The acceptor is told to stop before the loops, so it rarely posts to a
+     * loop that has already left its event loop; a socket posted in that
+     * window is closed by the loop's destructor.
+     */
+    void epoll_server_group::stop_server()
+    {
+        stop_acceptor();
+        for (auto &loop : loops)
+            loop->stop_server();
+    }
+
+    epoll_server_group::~epoll_server_group()
+    {
+        stop_server();
+        if (acceptor_thread.joinable())
+            acceptor_thread.join();
+        for (auto &t : threads)
+        {
+            if (t.joinable())
+                t.join();
+        }
+#if defined(__linux__) || defined(__linux)
+        if (acceptor_stop_fd != -1)
+            ::close(acceptor_stop_fd);
+#endif
+    }
+}
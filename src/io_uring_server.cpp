@@ -0,0 +1,973 @@
+/**
+ * @file io_uring_server.cpp
+ * @brief Implementation of the io_uring backend for the TCP server
+ *
+ * The ring is driven with the raw io_uring_setup/io_uring_enter/
+ * io_uring_register syscalls and the kernel UAPI header, so no liburing is
+ * needed. All connection state (connection table, output queues, pending
+ * writes, close requests) is shared with epoll_server; only the way I/O is
+ * issued differs.
+ *
+ * user_data encoding:
+ * - low 2 bits: operation tag
+ * - accept/recv: (generation << 34) | (fd << 2) | tag
+ * - send: pointer to the send_chain (8-byte aligned) | tag
+ *
+ * The per-fd generation is bumped on every close, so completions that belong
+ * to a previous connection on a reused fd number are recognized and dropped.
+ */
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include "../includes/io_uring_server.hpp"
+#include "../includes/utilities.hpp"
+
+#if defined(HH_SOCKET_IO_URING) && (defined(__linux__) || defined(__linux))
+#include <errno.h>
+#include <limits.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#define HH_SOCKET_HAS_IO_URING 1
+#endif
+
+namespace hh_socket
+{
+#if defined(HH_SOCKET_HAS_IO_URING)
+
+    namespace
+    {
+        const uint64_t TAG_NONE = 0; // Completion needs no handling (buffer hand-back)
+        const uint64_t TAG_ACCEPT = 1;
+        const uint64_t TAG_RECV = 2;
+        const uint64_t TAG_SEND = 3;
+        const uint64_t TAG_MASK = 3;
+
+        /// user_data of the wake_fd poll: no tag, distinct from TAG_NONE's 0
+        const uint64_t WAKE_TOKEN = 1 << 2 | TAG_NONE;
+
+        /// Upper bound on linked sendmsg SQEs submitted for one connection at once
+        const unsigned MAX_SEND_CHAIN = 8;
+
+        uint64_t make_fd_token(uint64_t tag, int fd, uint32_t gen)
+        {
+            return (static_cast<uint64_t>(gen) << 34) | (static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 2) | tag;
+        }
+
+        int token_fd(uint64_t data) { return static_cast<int>((data >> 2) & 0xffffffffULL); }
+
+        uint32_t token_gen(uint64_t data) { return static_cast<uint32_t>(data >> 34); }
+
+        int sys_io_uring_setup(unsigned entries, io_uring_params *p)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+        }
+
+        int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, std::size_t argsz)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+        }
+
+        int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+        }
+
+        /**
+         * @brief Output of one connection handed to the kernel as linked sendmsg SQEs
+         *
+         * Owns the queued messages while the kernel may still read them, so a
+         * connection closing mid-send cannot free memory under an in-flight op.
+         */
+        struct send_chain
+        {
+            int fd;
+            uint32_t gen;
+            std::vector<data_buffer> data;
+            std::size_t first_offset;
+            std::vector<iovec> iov;
+            std::vector<msghdr> msgs;
+            std::vector<std::size_t> msg_bytes;
+            std::vector<int> results;
+            unsigned pending = 0;
+
+            /// Set for a POLLOUT wait (socket full while sending a file segment) instead of sendmsg requests
+            bool poll = false;
+        };
+    }
+
+    /**
+     * @brief Memory-mapped ring, provided buffer ring and per-fd bookkeeping
+     */
+    struct io_uring_server::ring_state
+    {
+        /// Per file descriptor state of the io_uring backend
+        struct fd_state
+        {
+            uint32_t gen = 1;
+            bool recv_armed = false;
+            bool recv_cancelling = false;
+            send_chain *chain = nullptr;
+
+            /// Data that completed while the connection was write-blocked, delivered on resume
+            std::deque<data_buffer> held;
+        };
+
+        int ring_fd = -1;
+
+        // Submission queue
+        void *sq_ptr = MAP_FAILED;
+        std::size_t sq_len = 0;
+        unsigned *sq_head = nullptr;
+        unsigned *sq_tail = nullptr;
+        unsigned *sq_array = nullptr;
+        unsigned sq_mask = 0;
+        unsigned sq_entries = 0;
+        unsigned sq_local_tail = 0;
+        unsigned sq_submitted = 0;
+        io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+        std::size_t sqes_len = 0;
+
+        // Completion queue
+        void *cq_ptr = MAP_FAILED;
+        std::size_t cq_len = 0;
+        unsigned *cq_head = nullptr;
+        unsigned *cq_tail = nullptr;
+        unsigned cq_mask = 0;
+        io_uring_cqe *cqes = nullptr;
+
+        // Provided receive buffers (buffer group 0)
+        io_uring_buf_ring *buf_ring = static_cast<io_uring_buf_ring *>(MAP_FAILED);
+        std::size_t buf_ring_len = 0;
+        char *buf_base = nullptr;
+        unsigned buf_count = 0;
+        unsigned buf_size = 0;
+        unsigned short buf_tail = 0;
+
+        /// Buffers are handed back with IORING_OP_PROVIDE_BUFFERS instead of the ring
+        bool classic_buffers = false;
+
+        bool accept_armed = false;
+
+        /// A one-shot POLLIN on the loop's wake_fd is in flight
+        bool wake_armed = false;
+
+        std::vector<fd_state> fds;
+
+        /// Every chain the kernel may still reference, freed on teardown
+        std::vector<send_chain *> chains;
+
+        fd_state &state(int fd)
+        {
+            if (static_cast<std::size_t>(fd) >= fds.size())
+                fds.resize(std::max<std::size_t>(fd + 1, fds.size() * 2));
+            return fds[fd];
+        }
+
+        /**
+         * Makes sure `count` SQEs can be taken without an intermediate submit,
+         * so a linked chain is never split across two io_uring_enter calls.
+         */
+        void reserve(unsigned count)
+        {
+            unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+            if (sq_local_tail - head + count > sq_entries)
+                enter(false, 0);
+        }
+
+        io_uring_sqe *get_sqe()
+        {
+            reserve(1);
+            unsigned index = sq_local_tail & sq_mask;
+            io_uring_sqe *sqe = &sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sq_array[index] = index;
+            ++sq_local_tail;
+            return sqe;
+        }
+
+        /**
+         * Publishes queued SQEs and optionally waits for at least one
+         * completion, bounded by timeout (milliseconds, negative blocks).
+         */
+        void enter(bool wait, int timeout)
+        {
+            __atomic_store_n(sq_tail, sq_local_tail, __ATOMIC_RELEASE);
+            unsigned to_submit = sq_local_tail - sq_submitted;
+
+            unsigned flags = 0;
+            unsigned min_complete = 0;
+            io_uring_getevents_arg arg{};
+            __kernel_timespec ts{};
+            void *argp = nullptr;
+            std::size_t argsz = 0;
+
+            bool ready = *cq_head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            if (wait && !ready)
+            {
+                flags |= IORING_ENTER_GETEVENTS;
+                min_complete = 1;
+                if (timeout >= 0)
+                {
+                    ts.tv_sec = timeout / 1000;
+                    ts.tv_nsec = static_cast<long long>(timeout % 1000) * 1000000LL;
+                    arg.sigmask_sz = _NSIG / 8;
+                    arg.ts = reinterpret_cast<uint64_t>(&ts);
+                    argp = &arg;
+                    argsz = sizeof(arg);
+                    flags |= IORING_ENTER_EXT_ARG;
+                }
+            }
+            if (to_submit == 0 && min_complete == 0)
+                return;
+
+            int r = sys_io_uring_enter(ring_fd, to_submit, min_complete, flags, argp, argsz);
+            if (r >= 0)
+                sq_submitted += static_cast<unsigned>(r);
+            else if (errno != EINTR && errno != ETIME && errno != EAGAIN && errno != EBUSY)
+                throw std::runtime_error("io_uring_enter failed: " + std::string(strerror(errno)));
+        }
+
+        void recycle_buffer(unsigned bid)
+        {
+            if (classic_buffers)
+            {
+                io_uring_sqe *sqe = get_sqe();
+                sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+                sqe->fd = 1;
+                sqe->addr = reinterpret_cast<uint64_t>(buf_base + static_cast<std::size_t>(bid) * buf_size);
+                sqe->len = buf_size;
+                sqe->off = bid;
+                sqe->buf_group = 0;
+                sqe->user_data = TAG_NONE;
+                return;
+            }
+            unsigned mask = buf_count - 1;
+            io_uring_buf *b = &buf_ring->bufs[buf_tail & mask];
+            b->addr = reinterpret_cast<uint64_t>(buf_base + static_cast<std::size_t>(bid) * buf_size);
+            b->len = buf_size;
+            b->bid = static_cast<unsigned short>(bid);
+            ++buf_tail;
+            __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+        }
+
+        /**
+         * Receives one byte over a socketpair with buffer selection. Some
+         * kernels accept IORING_REGISTER_PBUF_RING but never select from the
+         * ring (every recv fails with ENOBUFS); this catches them at setup.
+         */
+        bool buffer_ring_works()
+        {
+            int sv[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+                return false;
+            bool ok = false;
+            if (::write(sv[1], "x", 1) == 1)
+            {
+                io_uring_sqe *sqe = get_sqe();
+                sqe->opcode = IORING_OP_RECV;
+                sqe->fd = sv[0];
+                sqe->flags = IOSQE_BUFFER_SELECT;
+                sqe->buf_group = 0;
+                sqe->user_data = TAG_NONE;
+                enter(true, 1000);
+
+                unsigned head = *cq_head;
+                if (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+                {
+                    io_uring_cqe cqe = cqes[head & cq_mask];
+                    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+                    ok = cqe.res == 1 && (cqe.flags & IORING_CQE_F_BUFFER);
+                    if (ok)
+                        recycle_buffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                }
+            }
+            ::close(sv[0]);
+            ::close(sv[1]);
+            return ok;
+        }
+
+        void arm_accept(int listen_fd)
+        {
+            io_uring_sqe *sqe = get_sqe();
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->fd = listen_fd;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            sqe->user_data = TAG_ACCEPT;
+            accept_armed = true;
+        }
+
+        void arm_wake(int wake_fd)
+        {
+            io_uring_sqe *sqe = get_sqe();
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = wake_fd;
+            sqe->poll32_events = POLLIN;
+            sqe->user_data = WAKE_TOKEN;
+            wake_armed = true;
+        }
+
+        void arm_recv(int fd)
+        {
+            fd_state &st = state(fd);
+            io_uring_sqe *sqe = get_sqe();
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = fd;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = 0;
+            sqe->user_data = make_fd_token(TAG_RECV, fd, st.gen);
+            st.recv_armed = true;
+        }
+
+        /// Terminates the multishot recv of fd (pauses reading); its last CQE reports -ECANCELED
+        void cancel_recv(int fd)
+        {
+            fd_state &st = state(fd);
+            if (!st.recv_armed || st.recv_cancelling)
+                return;
+            io_uring_sqe *sqe = get_sqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = make_fd_token(TAG_RECV, fd, st.gen);
+            sqe->user_data = TAG_NONE;
+            st.recv_cancelling = true;
+        }
+
+        void release_chain(send_chain *ch)
+        {
+            for (auto &p : chains)
+            {
+                if (p == ch)
+                {
+                    p = chains.back();
+                    chains.pop_back();
+                    break;
+                }
+            }
+            delete ch;
+        }
+
+        ~ring_state()
+        {
+            // Closing the ring cancels every request still in flight
+            if (ring_fd >= 0)
+                ::close(ring_fd);
+            if (buf_ring != MAP_FAILED)
+                munmap(buf_ring, buf_ring_len);
+            std::free(buf_base);
+            if (sqes != MAP_FAILED)
+                munmap(sqes, sqes_len);
+            if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+                munmap(cq_ptr, cq_len);
+            if (sq_ptr != MAP_FAILED)
+                munmap(sq_ptr, sq_len);
+            for (auto *ch : chains)
+                delete ch;
+        }
+    };
+
+    /**
+     * Setup Steps:
+     * 1. io_uring_setup() with SINGLE_ISSUER | COOP_TASKRUN (retried without
+     *    the flags on kernels that reject them)
+     * 2. Require IORING_FEAT_SINGLE_MMAP, IORING_FEAT_NODROP and
+     *    IORING_FEAT_EXT_ARG, and probe for IORING_OP_SEND_ZC, which landed in
+     *    the same release (6.0) as multishot recv
+     * 3. Map the SQ/CQ rings and the SQE array
+     * 4. Register a provided buffer ring and fill it with receive buffers;
+     *    if the kernel does not select from it, unregister it and provide the
+     *    same buffers with IORING_OP_PROVIDE_BUFFERS instead
+     *
+     * Any failure releases what was created and returns false, which makes
+     * listen() fall back to epoll.
+     */
+    bool io_uring_server::setup_ring()
+    {
+        if (ring)
+            return true;
+
+        auto st = std::make_unique<ring_state>();
+
+        io_uring_params params{};
+        params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+        st->ring_fd = sys_io_uring_setup(ring_entries, &params);
+        if (st->ring_fd < 0 && errno == EINVAL)
+        {
+            params = io_uring_params{};
+            st->ring_fd = sys_io_uring_setup(ring_entries, &params);
+        }
+        if (st->ring_fd < 0)
+            return false;
+
+        const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+        if ((params.features & required) != required)
+            return false;
+
+        // Multishot recv has no feature bit; IORING_OP_SEND_ZC shipped with it in 6.0
+        std::size_t probe_len = sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op);
+        std::vector<char> probe_mem(probe_len, 0);
+        auto *probe = reinterpret_cast<io_uring_probe *>(probe_mem.data());
+        if (sys_io_uring_register(st->ring_fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0 ||
+            probe->last_op < IORING_OP_SEND_ZC ||
+            !(probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED))
+            return false;
+
+        st->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        st->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        st->sq_len = st->cq_len = std::max(st->sq_len, st->cq_len);
+        st->sq_ptr = mmap(nullptr, st->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, st->ring_fd, IORING_OFF_SQ_RING);
+        if (st->sq_ptr == MAP_FAILED)
+            return false;
+        st->cq_ptr = st->sq_ptr;
+
+        char *sq = static_cast<char *>(st->sq_ptr);
+        st->sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        st->sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        st->sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        st->sq_entries = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+        st->sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        st->sq_local_tail = st->sq_submitted = *st->sq_tail;
+
+        st->cq_head = reinterpret_cast<unsigned *>(sq + params.cq_off.head);
+        st->cq_tail = reinterpret_cast<unsigned *>(sq + params.cq_off.tail);
+        st->cq_mask = *reinterpret_cast<unsigned *>(sq + params.cq_off.ring_mask);
+        st->cqes = reinterpret_cast<io_uring_cqe *>(sq + params.cq_off.cqes);
+
+        st->sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+        st->sqes = static_cast<io_uring_sqe *>(mmap(nullptr, st->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, st->ring_fd, IORING_OFF_SQES));
+        if (st->sqes == MAP_FAILED)
+            return false;
+
+        // Provided buffer ring: entries must be a power of two (max 32768)
+        unsigned count = 1;
+        while (count < recv_buffer_count && count < 32768)
+            count <<= 1;
+        st->buf_count = count;
+        st->buf_size = recv_buffer_size;
+        st->buf_ring_len = count * sizeof(io_uring_buf);
+        st->buf_ring = static_cast<io_uring_buf_ring *>(mmap(nullptr, st->buf_ring_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (st->buf_ring == MAP_FAILED)
+            return false;
+
+        // Fault the pages in before the kernel pins them
+        memset(st->buf_ring, 0, st->buf_ring_len);
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(st->buf_ring);
+        reg.ring_entries = count;
+        reg.bgid = 0;
+        if (sys_io_uring_register(st->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+            return false;
+
+        st->buf_base = static_cast<char *>(std::malloc(static_cast<std::size_t>(count) * recv_buffer_size));
+        if (!st->buf_base)
+            return false;
+        for (unsigned bid = 0; bid < count; ++bid)
+            st->recycle_buffer(bid);
+
+        if (!st->buffer_ring_works())
+        {
+            if (sys_io_uring_register(st->ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1) < 0)
+                return false;
+            st->classic_buffers = true;
+            io_uring_sqe *sqe = st->get_sqe();
+            sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+            sqe->fd = static_cast<int>(count);
+            sqe->addr = reinterpret_cast<uint64_t>(st->buf_base);
+            sqe->len = recv_buffer_size;
+            sqe->off = 0;
+            sqe->buf_group = 0;
+            sqe->user_data = TAG_NONE;
+        }
+
+        ring = std::move(st);
+        return true;
+    }
+
+    /**
+     * Chain Construction:
+     * 1. Move up to MAX_SEND_CHAIN * IOV_MAX queued messages out of outq into
+     *    the chain, which owns them until the kernel is done
+     * 2. Split their iovecs into sendmsg requests of at most IOV_MAX segments
+     * 3. Link the requests with IOSQE_IO_LINK so the kernel sends them in
+     *    order. MSG_WAITALL makes the kernel finish each request before the
+     *    next one starts; without it a short send would not break the link
+     *    and later bytes could overtake the unsent tail. An error cancels the
+     *    rest of the chain
+     *
+     * Only one chain per connection is in flight at a time; messages queued
+     * meanwhile are picked up when it completes.
+     *
+     * File segments (send_file()) at the head of the output are written
+     * right here with sendfile(), which copies from the page cache without
+     * touching user memory. If the socket fills up, a POLLOUT request takes
+     * the chain's place and its completion resumes the output. Buffers are
+     * only gathered up to the next segment, to keep the stream in order.
+     */
+    void io_uring_server::submit_send(epoll_connection &c)
+    {
+        int fd = c.conn->get_fd();
+        auto &st = ring->state(fd);
+        if (st.chain)
+            return; // Completion of the running chain submits the rest
+
+        while (c.file_at_head())
+        {
+            if (!flush_file(c))
+            {
+                auto *ch = new send_chain();
+                ch->fd = fd;
+                ch->gen = st.gen;
+                ch->first_offset = 0;
+                ch->poll = true;
+                io_uring_sqe *sqe = ring->get_sqe();
+                sqe->opcode = IORING_OP_POLL_ADD;
+                sqe->fd = fd;
+                sqe->poll32_events = POLLOUT;
+                sqe->user_data = reinterpret_cast<uint64_t>(ch) | TAG_SEND;
+                ch->pending = 1;
+                st.chain = ch;
+                ring->chains.push_back(ch);
+                return;
+            }
+        }
+
+        auto *ch = new send_chain();
+        ch->fd = fd;
+        ch->gen = st.gen;
+        ch->first_offset = c.out_offset;
+        c.out_offset = 0;
+
+        std::size_t limit = static_cast<std::size_t>(MAX_SEND_CHAIN) * IOV_MAX;
+        uint64_t byte_limit = c.out_files.empty() ? UINT64_MAX : c.out_files.front().stream_pos - c.out_written;
+        uint64_t gathered = 0;
+        ch->data.reserve(std::min(limit, c.outq.size()));
+        while (!c.outq.empty() && ch->data.size() < limit && gathered < byte_limit)
+        {
+            gathered += c.outq.front().size() - (ch->data.empty() ? ch->first_offset : 0);
+            ch->data.push_back(std::move(c.outq.front()));
+            c.outq.pop_front();
+        }
+
+        ch->iov.reserve(ch->data.size());
+        std::size_t offset = ch->first_offset;
+        for (auto &msg : ch->data)
+        {
+            if (msg.size() > offset)
+                ch->iov.push_back(iovec{const_cast<char *>(msg.data()) + offset, msg.size() - offset});
+            offset = 0;
+        }
+        if (ch->iov.empty())
+        {
+            delete ch;
+            return;
+        }
+
+        std::size_t groups = (ch->iov.size() + IOV_MAX - 1) / IOV_MAX;
+        ch->msgs.resize(groups);
+        ch->msg_bytes.resize(groups, 0);
+        for (std::size_t g = 0; g < groups; ++g)
+        {
+            std::size_t first = g * IOV_MAX;
+            std::size_t count = std::min<std::size_t>(IOV_MAX, ch->iov.size() - first);
+            ch->msgs[g] = msghdr{};
+            ch->msgs[g].msg_iov = &ch->iov[first];
+            ch->msgs[g].msg_iovlen = count;
+            for (std::size_t k = first; k < first + count; ++k)
+                ch->msg_bytes[g] += ch->iov[k].iov_len;
+        }
+
+        ring->reserve(static_cast<unsigned>(groups));
+        for (std::size_t g = 0; g < groups; ++g)
+        {
+            io_uring_sqe *sqe = ring->get_sqe();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(&ch->msgs[g]);
+            sqe->len = 1;
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            if (g + 1 < groups)
+                sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = reinterpret_cast<uint64_t>(ch) | TAG_SEND;
+        }
+        ch->pending = static_cast<unsigned>(groups);
+        st.chain = ch;
+        ring->chains.push_back(ch);
+    }
+
+    /**
+     * shutdown() makes the kernel complete the multishot recv and any send
+     * still in flight on this socket; bumping the generation marks those late
+     * completions as stale. The rest is the regular epoll_server cleanup.
+     */
+    void io_uring_server::uring_close(int fd)
+    {
+        ::shutdown(fd, SHUT_RDWR);
+        auto &st = ring->state(fd);
+        ++st.gen;
+        st.recv_armed = false;
+        st.recv_cancelling = false;
+        st.held.clear();
+        close_conn(fd);
+    }
+
+    /**
+     * Also reached for sockets handed over by post_accepted(), which must
+     * get a multishot recv just like those accepted on the ring.
+     */
+    void io_uring_server::accept_conn(socket_t cfd, sockaddr_storage &client_addr)
+    {
+        if (!using_ring)
+        {
+            epoll_server::accept_conn(cfd, client_addr);
+            return;
+        }
+        if (!admit_peer(cfd, client_addr))
+        {
+            ::close(cfd);
+            return;
+        }
+        ring->state(cfd).recv_armed = false;
+        open_conn(cfd, client_addr);
+        epoll_connection *c = conns.find(cfd);
+        if (c && !c->want_close)
+            ring->arm_recv(cfd);
+    }
+
+    /**
+     * Reading is paused by cancelling the multishot recv rather than just not
+     * re-arming it, so a fast sender cannot keep delivering data into the
+     * application while its output is blocked. Completions the kernel posted
+     * before the cancel took effect are held back and delivered on resume,
+     * before the recv is re-armed.
+     */
+    void io_uring_server::update_write_block(epoll_connection &c)
+    {
+        int fd = c.conn->get_fd();
+        if (!release_write_block(c))
+        {
+            ring->cancel_recv(fd);
+            return;
+        }
+        on_write_drained(c.conn);
+
+        auto &st = ring->state(fd);
+        while (!st.held.empty() && !c.write_blocked && !c.want_close)
+        {
+            data_buffer db = std::move(st.held.front());
+            st.held.pop_front();
+            deliver_message(c, db);
+        }
+        // Re-arm now, unless the cancelled recv has yet to complete; its
+        // completion re-arms it then
+        if (!st.recv_armed && !c.want_close && !c.read_stopped && !c.write_blocked)
+            ring->arm_recv(fd);
+    }
+
+    void io_uring_server::uring_flush_pending()
+    {
+        while (!pending_flush.empty())
+        {
+            pending_swap.swap(pending_flush);
+            for (int fd : pending_swap)
+            {
+                epoll_connection *found = conns.find(fd);
+                if (!found)
+                    continue; // Connection already closed
+                epoll_connection &c = *found;
+                c.flush_pending = false;
+
+                if (c.write_blocked)
+                    update_write_block(c);
+                if (c.has_output())
+                    submit_send(c);
+                else if (c.want_close && (c.want_abort || !ring->state(fd).chain))
+                    uring_close(fd); // An abort does not wait for the chain in flight
+            }
+            pending_swap.clear();
+        }
+    }
+
+    /**
+     * Event Loop Algorithm:
+     * 1. (Re)arm the multishot accept if it terminated, and the poll on
+     *    wake_fd that signals commands posted from other threads
+     * 2. Turn queued output and close requests into SQEs
+     * 3. One io_uring_enter(): submit everything and wait for completions
+     * 4. Reap all CQEs:
+     *    - accept: register the connection and arm its multishot recv
+     *    - recv: hand the provided buffer's bytes to on_message_received,
+     *      recycle the buffer, re-arm if the multishot ended
+     *    - send: when the whole chain completed, return unsent bytes to the
+     *      front of outq and continue or close
+     *    - wake: drain the command queue
+     * 5. Repeat until stop signal
+     */
+    void io_uring_server::uring_loop(int timeout)
+    {
+        on_listen_success();
+        while (!g_stop)
+            try
+            {
+                if (listener_socket && !ring->accept_armed)
+                    ring->arm_accept(listener_socket->get_fd());
+                if (wake_fd != -1 && !ring->wake_armed)
+                    ring->arm_wake(wake_fd);
+
+                on_waiting_for_activity();
+                uring_flush_pending();
+                ring->enter(true, timers.next_timeout(timeout));
+                loop_time = timer_wheel::clock_ms();
+
+                unsigned head = *ring->cq_head;
+                unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+                bump(load_events, tail - head);
+                while (head != tail)
+                {
+                    io_uring_cqe cqe = ring->cqes[head & ring->cq_mask];
+                    ++head;
+                    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+                    if (cqe.user_data == WAKE_TOKEN)
+                    {
+                        // Commands posted from other threads; re-armed next iteration
+                        ring->wake_armed = false;
+                        drain_commands();
+                        continue;
+                    }
+
+                    uint64_t tag = cqe.user_data & TAG_MASK;
+                    if (tag == TAG_ACCEPT)
+                    {
+                        if (!(cqe.flags & IORING_CQE_F_MORE))
+                            ring->accept_armed = false;
+                        if (cqe.res < 0)
+                            continue; // EMFILE and friends, retried on re-arm
+                        int cfd = cqe.res;
+                        try
+                        {
+                            sockaddr_storage client_addr{};
+                            socklen_t client_addr_len = sizeof(client_addr);
+                            ::getpeername(cfd, reinterpret_cast<sockaddr *>(&client_addr), &client_addr_len);
+                            accept_conn(cfd, client_addr);
+                        }
+                        catch (const std::exception &e)
+                        {
+                            on_exception_occurred(e);
+                        }
+                    }
+                    else if (tag == TAG_RECV)
+                    {
+                        int fd = token_fd(cqe.user_data);
+                        bool has_buffer = cqe.flags & IORING_CQE_F_BUFFER;
+                        unsigned bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                        auto &st = ring->state(fd);
+                        epoll_connection *c = conns.find(fd);
+                        if (st.gen != token_gen(cqe.user_data) || !c)
+                        {
+                            // Completion for a connection that is already gone
+                            if (has_buffer)
+                                ring->recycle_buffer(bid);
+                            continue;
+                        }
+                        if (!(cqe.flags & IORING_CQE_F_MORE))
+                            st.recv_armed = st.recv_cancelling = false;
+
+                        if (cqe.res > 0 && has_buffer)
+                        {
+                            // The provided buffer goes straight back to the kernel, so this is the
+                            // one copy; it lands in a pooled block like the epoll path reads into
+                            const char *src = ring->buf_base + static_cast<std::size_t>(bid) * ring->buf_size;
+                            std::size_t n = static_cast<std::size_t>(cqe.res);
+                            data_buffer db;
+                            if (n <= recv_pool.block_size())
+                            {
+                                if (prepare_read_block() < n)
+                                {
+                                    read_block.reset();
+                                    prepare_read_block();
+                                }
+                                memcpy(&(*read_block)[read_used], src, n);
+                                db = data_buffer(read_block, read_used, n);
+                                read_used += n;
+                            }
+                            else
+                                db = data_buffer(src, n);
+                            ring->recycle_buffer(bid);
+                            c->last_read = loop_time;
+                            if (c->write_blocked)
+                                ring->state(fd).held.push_back(std::move(db)); // Reading is paused
+                            else if (!c->want_close)
+                                deliver_message(*c, db);
+                        }
+                        else
+                        {
+                            if (has_buffer)
+                                ring->recycle_buffer(bid);
+                            if (cqe.res == 0 || (cqe.res != -ENOBUFS && cqe.res != -EINTR && cqe.res != -ECANCELED))
+                            {
+                                // Peer closed the connection or a receive error
+                                uring_close(fd);
+                                continue;
+                            }
+                        }
+
+                        // The callback may have closed the connection
+                        c = conns.find(fd);
+                        auto &cur = ring->state(fd);
+                        if (c && cur.gen == token_gen(cqe.user_data) && !cur.recv_armed &&
+                            !c->want_close && !c->read_stopped && !c->write_blocked)
+                            ring->arm_recv(fd);
+                    }
+                    else if (tag == TAG_SEND)
+                    {
+                        auto *ch = reinterpret_cast<send_chain *>(cqe.user_data & ~TAG_MASK);
+                        ch->results.push_back(cqe.res);
+                        if (cqe.res > 0 && !ch->poll && ring->state(ch->fd).gen == ch->gen)
+                        {
+                            // Every completed request is write progress for the write deadline
+                            if (epoll_connection *progress = conns.find(ch->fd))
+                                progress->last_write = loop_time;
+                        }
+                        if (--ch->pending > 0)
+                            continue;
+
+                        int fd = ch->fd;
+                        auto &st = ring->state(fd);
+                        if (st.chain == ch)
+                            st.chain = nullptr;
+                        epoll_connection *c = conns.find(fd);
+                        bool alive = st.gen == ch->gen && c != nullptr;
+
+                        bool failed = false;
+                        std::size_t sent = 0;
+                        if (ch->poll)
+                            failed = ch->results[0] < 0 && ch->results[0] != -ECANCELED;
+                        for (std::size_t g = 0; g < ch->results.size() && !ch->poll; ++g)
+                        {
+                            int r = ch->results[g];
+                            if (r < 0)
+                            {
+                                failed = r != -ECANCELED && r != -EAGAIN && r != -EINTR;
+                                break;
+                            }
+                            sent += static_cast<std::size_t>(r);
+                            if (static_cast<std::size_t>(r) < ch->msg_bytes[g])
+                                break;
+                        }
+
+                        if (alive)
+                        {
+                            c->out_written += sent;
+                            account_written(*c, sent);
+                        }
+                        if (alive && !failed && !c->want_abort)
+                        {
+                            // Give the unsent remainder back to the front of the queue
+                            std::size_t skip = ch->first_offset + sent;
+                            std::size_t first = 0;
+                            while (first < ch->data.size() && skip >= ch->data[first].size())
+                            {
+                                skip -= ch->data[first].size();
+                                ++first;
+                            }
+                            for (std::size_t k = ch->data.size(); k > first; --k)
+                                c->outq.push_front(std::move(ch->data[k - 1]));
+                            if (first < ch->data.size())
+                                c->out_offset = skip;
+                        }
+                        ring->release_chain(ch);
+
+                        if (alive && failed)
+                        {
+                            uring_close(fd);
+                            continue;
+                        }
+                        c = conns.find(fd);
+                        if (!c)
+                            continue;
+                        if (c->write_blocked)
+                            update_write_block(*c);
+                        if (c->has_output())
+                            submit_send(*c);
+                        else if (c->want_close)
+                            uring_close(fd);
+                    }
+                }
+
+                // Fire expired connection deadlines and user timers
+                run_timers();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "UNKNOWN ERROR CAUGHT BY EVENT LOOP: " << e.what() << std::endl;
+                on_exception_occurred(e);
+            }
+
+        wait_offloaded();
+        on_shutdown_success();
+    }
+
+#else
+
+    /// io_uring not compiled in (IO_URING option off or not Linux): always use epoll
+    struct io_uring_server::ring_state
+    {
+    };
+
+    bool io_uring_server::setup_ring() { return false; }
+
+    void io_uring_server::uring_loop(int) {}
+
+    void io_uring_server::uring_flush_pending() {}
+
+    void io_uring_server::submit_send(epoll_connection &) {}
+
+    void io_uring_server::uring_close(int) {}
+
+    void io_uring_server::accept_conn(socket_t cfd, sockaddr_storage &client_addr)
+    {
+        epoll_server::accept_conn(cfd, client_addr);
+    }
+
+#endif
+
+    io_uring_server::io_uring_server(int max_fds, unsigned ring_entries,
+                                     unsigned recv_buffer_count, unsigned recv_buffer_size)
+        : epoll_server(max_fds), ring_entries(ring_entries),
+          recv_buffer_count(recv_buffer_count), recv_buffer_size(recv_buffer_size)
+    {
+    }
+
+    bool io_uring_server::is_using_io_uring() const
+    {
+        return using_ring;
+    }
+
+    /**
+     * Backend Selection:
+     * - io_uring when compiled in and the kernel supports every feature used
+     * - epoll_server::listen() otherwise, with identical callbacks
+     */
+    void io_uring_server::listen(int timeout)
+    {
+        using_ring = setup_ring();
+        if (using_ring)
+            uring_loop(timeout);
+        else
+            epoll_server::listen(timeout);
+    }
+
+    io_uring_server::~io_uring_server() = default;
+}
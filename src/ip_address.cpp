@@ -0,0 +1,349 @@
+/**
+ * @file ip_address.cpp
+ * @brief Binary IP address parsing, formatting and prefix matching
+ */
+
+#include "../includes/ip_address.hpp"
+
+namespace hh_socket
+{
+    namespace
+    {
+        /// Hex digit values by character, -1 for anything else
+        struct hex_table
+        {
+            signed char values[256];
+
+            hex_table()
+            {
+                for (int c = 0; c < 256; ++c)
+                    values[c] = -1;
+                for (int c = 0; c < 10; ++c)
+                    values['0' + c] = static_cast<signed char>(c);
+                for (int c = 0; c < 6; ++c)
+                {
+                    values['a' + c] = static_cast<signed char>(10 + c);
+                    values['A' + c] = static_cast<signed char>(10 + c);
+                }
+            }
+        };
+
+        const hex_table hex_digits;
+
+        /// Value of a hex digit, or -1
+        inline int hex_value(char c)
+        {
+            return hex_digits.values[static_cast<unsigned char>(c)];
+        }
+
+        /**
+         * Parses exactly four dot-separated decimal octets, like inet_pton(AF_INET):
+         * 1 to 3 digits each, no leading zeros, at most 255.
+         */
+        bool parse_v4(const char *text, std::size_t len, std::uint8_t *out)
+        {
+            std::size_t i = 0;
+            for (int part = 0; part < 4; ++part)
+            {
+                if (part > 0)
+                {
+                    if (i == len || text[i] != '.')
+                        return false;
+                    ++i;
+                }
+                std::size_t start = i;
+                unsigned value = 0;
+                while (i < len && i - start < 3 && text[i] >= '0' && text[i] <= '9')
+                    value = value * 10 + static_cast<unsigned>(text[i++] - '0');
+                if (i == start || value > 255 || (text[start] == '0' && i - start > 1))
+                    return false;
+                out[part] = static_cast<std::uint8_t>(value);
+            }
+            return i == len;
+        }
+
+        /**
+         * Parses up to eight colon-separated groups of 1 to 4 hex digits with at
+         * most one "::", and an optional dotted-quad in place of the last two
+         * groups, like inet_pton(AF_INET6).
+         */
+        bool parse_v6(const char *text, std::size_t len, std::uint8_t *out)
+        {
+            std::uint8_t bytes[16] = {};
+            std::size_t count = 0; // bytes written
+            long gap = -1;         // byte offset of "::"
+            std::size_t i = 0;
+
+            if (len >= 1 && text[0] == ':')
+            {
+                if (len < 2 || text[1] != ':')
+                    return false;
+                gap = 0;
+                i = 2;
+            }
+
+            while (i < len)
+            {
+                if (count == 16)
+                    return false;
+
+                std::size_t start = i;
+                unsigned value = 0;
+                int digit;
+                while (i < len && i - start < 4 && (digit = hex_value(text[i])) >= 0)
+                {
+                    value = (value << 4) | static_cast<unsigned>(digit);
+                    ++i;
+                }
+                if (i == start)
+                    return false;
+
+                if (i < len && text[i] == '.')
+                {
+                    // Dotted-quad tail: must end the text and fit in the last two groups
+                    if (count > 12 || !parse_v4(text + start, len - start, bytes + count))
+                        return false;
+                    count += 4;
+                    i = len;
+                    break;
+                }
+
+                bytes[count++] = static_cast<std::uint8_t>(value >> 8);
+                bytes[count++] = static_cast<std::uint8_t>(value);
+
+                if (i == len)
+                    break;
+                if (text[i] != ':')
+                    return false;
+                ++i;
+                if (i < len && text[i] == ':')
+                {
+                    if (gap >= 0)
+                        return false;
+                    gap = static_cast<long>(count);
+                    ++i;
+                }
+                else if (i == len)
+                {
+                    // A single trailing colon
+                    return false;
+                }
+            }
+
+            if (gap < 0)
+            {
+                if (count != 16)
+                    return false;
+                std::memcpy(out, bytes, 16);
+                return true;
+            }
+
+            // "::" stands for at least one zero group
+            if (count == 16)
+                return false;
+            std::size_t head = static_cast<std::size_t>(gap);
+            std::size_t tail = count - head;
+            std::memset(out, 0, 16);
+            std::memcpy(out, bytes, head);
+            std::memcpy(out + 16 - tail, bytes + head, tail);
+            return true;
+        }
+
+        /// Writes 0-255 in decimal, returns the number of characters
+        inline std::size_t format_octet(std::uint8_t value, char *out)
+        {
+            if (value >= 100)
+            {
+                out[0] = static_cast<char>('0' + value / 100);
+                out[1] = static_cast<char>('0' + value / 10 % 10);
+                out[2] = static_cast<char>('0' + value % 10);
+                return 3;
+            }
+            if (value >= 10)
+            {
+                out[0] = static_cast<char>('0' + value / 10);
+                out[1] = static_cast<char>('0' + value % 10);
+                return 2;
+            }
+            out[0] = static_cast<char>('0' + value);
+            return 1;
+        }
+
+        std::size_t format_v4(const std::uint8_t *bytes, char *out)
+        {
+            std::size_t n = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                if (i > 0)
+                    out[n++] = '.';
+                n += format_octet(bytes[i], out + n);
+            }
+            return n;
+        }
+
+        /// Writes a 16-bit group in lowercase hex without leading zeros
+        inline std::size_t format_group(unsigned value, char *out)
+        {
+            static const char digits[] = "0123456789abcdef";
+            std::size_t n = 0;
+            for (int shift = 12; shift >= 0; shift -= 4)
+            {
+                unsigned digit = (value >> shift) & 0xf;
+                if (n > 0 || digit != 0 || shift == 0)
+                    out[n++] = digits[digit];
+            }
+            return n;
+        }
+    }
+
+    bool ip_address::parse(const char *text, std::size_t len, ip_address &out)
+    {
+        // A ':' within the first group means IPv6, anything else is tried as IPv4
+        std::size_t i = 0;
+        while (i < len && i < 5 && text[i] != ':' && text[i] != '.')
+            ++i;
+
+        ip_address result;
+        if (i < len && text[i] == ':')
+        {
+            if (!parse_v6(text, len, result.octets))
+                return false;
+            result.length = 16;
+        }
+        else
+        {
+            if (!parse_v4(text, len, result.octets))
+                return false;
+            result.length = 4;
+        }
+        out = result;
+        return true;
+    }
+
+    ip_address ip_address::from_bytes(const void *bytes, std::size_t len)
+    {
+        ip_address result;
+        if (len == 4 || len == 16)
+        {
+            std::memcpy(result.octets, bytes, len);
+            result.length = static_cast<std::uint8_t>(len);
+        }
+        return result;
+    }
+
+    ip_address ip_address::from_sockaddr(const sockaddr_storage &addr)
+    {
+        if (addr.ss_family == IPV4)
+            return from_bytes(&reinterpret_cast<const sockaddr_in *>(&addr)->sin_addr, 4);
+        if (addr.ss_family == IPV6)
+            return from_bytes(&reinterpret_cast<const sockaddr_in6 *>(&addr)->sin6_addr, 16);
+        return ip_address();
+    }
+
+    std::string ip_address::get() const
+    {
+        char text[MAX_TEXT_LENGTH];
+        return std::string(text, format(text));
+    }
+
+    /**
+     * Algorithm (RFC 5952):
+     * 1. IPv4 is written as a dotted quad
+     * 2. IPv4-mapped IPv6 is written as ::ffff: followed by a dotted quad
+     * 3. Otherwise the longest run of two or more zero groups (the first
+     *    one on a tie) becomes "::", and every other group is written in
+     *    lowercase hex without leading zeros
+     */
+    std::size_t ip_address::format(char *out) const
+    {
+        std::size_t n = 0;
+        if (length == 4)
+        {
+            n = format_v4(octets, out);
+        }
+        else if (length == 16)
+        {
+            if (is_v4_mapped())
+            {
+                std::memcpy(out, "::ffff:", 7);
+                n = 7 + format_v4(octets + 12, out + 7);
+            }
+            else
+            {
+                unsigned groups[8];
+                for (int i = 0; i < 8; ++i)
+                    groups[i] = (static_cast<unsigned>(octets[2 * i]) << 8) | octets[2 * i + 1];
+
+                int best = -1, best_len = 1;
+                for (int i = 0; i < 8;)
+                {
+                    if (groups[i] != 0)
+                    {
+                        ++i;
+                        continue;
+                    }
+                    int j = i;
+                    while (j < 8 && groups[j] == 0)
+                        ++j;
+                    if (j - i > best_len)
+                    {
+                        best = i;
+                        best_len = j - i;
+                    }
+                    i = j;
+                }
+
+                for (int i = 0; i < 8; ++i)
+                {
+                    if (i == best)
+                    {
+                        out[n++] = ':';
+                        out[n++] = ':';
+                        i += best_len - 1;
+                        continue;
+                    }
+                    if (i > 0 && i != best + best_len)
+                        out[n++] = ':';
+                    n += format_group(groups[i], out + n);
+                }
+            }
+        }
+        out[n] = '\0';
+        return n;
+    }
+
+    bool ip_address::is_v4_mapped() const
+    {
+        static const std::uint8_t prefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+        return length == 16 && std::memcmp(octets, prefix, sizeof(prefix)) == 0;
+    }
+
+    ip_address ip_address::unmapped() const
+    {
+        return is_v4_mapped() ? from_bytes(octets + 12, 4) : *this;
+    }
+
+    bool ip_address::in_subnet(const ip_address &network, int prefix_length) const
+    {
+        if (prefix_length < 0 || network.empty())
+            return false;
+
+        ip_address candidate = network.is_ipv4() ? unmapped() : *this;
+        if (candidate.length != network.length)
+            return false;
+
+        std::size_t bits = static_cast<std::size_t>(prefix_length);
+        if (bits > 8u * network.length)
+            bits = 8u * network.length;
+
+        std::size_t whole = bits / 8;
+        if (std::memcmp(candidate.octets, network.octets, whole) != 0)
+            return false;
+
+        std::size_t rest = bits % 8;
+        if (rest == 0)
+            return true;
+        std::uint8_t mask = static_cast<std::uint8_t>(0xff << (8 - rest));
+        return (candidate.octets[whole] & mask) == (network.octets[whole] & mask);
+    }
+}
@@ -0,0 +1,194 @@
+/**
+ * @file ip_filter.cpp
+ * @brief Implementation of the CIDR rule trie and its publisher
+ */
+
+#include <algorithm>
+
+#include "../includes/ip_filter.hpp"
+#include "../includes/exceptions.hpp"
+
+namespace hh_socket
+{
+    namespace
+    {
+        /// i-th 4-bit group of an address, most significant first
+        inline unsigned nibble(const std::uint8_t *bytes, int i)
+        {
+            return (i & 1) ? bytes[i >> 1] & 0xf : bytes[i >> 1] >> 4;
+        }
+    }
+
+    ip_filter_rules::ip_filter_rules(ip_filter_action default_action)
+        : v4_nodes(1), v6_nodes(1), default_action(default_action)
+    {
+    }
+
+    /**
+     * Algorithm (controlled prefix expansion):
+     * 1. A prefix of p bits ends in trie level (p - 1) / 4, creating the
+     *    nodes on the way
+     * 2. Its last r = 1..4 bits fix only the top r bits of that level's
+     *    4-bit value, so the rule goes into 2^(4 - r) slots
+     * 3. A slot keeps whichever rule has the longer prefix; on a tie the
+     *    rule added last wins
+     *
+     * Rules in deeper levels always have longer prefixes, so a lookup can
+     * simply keep the last rule it sees on its way down.
+     */
+    void ip_filter_rules::insert(int32_t rule_index)
+    {
+        const ip_filter_rule &rule = rules[static_cast<std::size_t>(rule_index)];
+        const std::uint8_t *bytes = rule.network.data();
+        int prefix = rule.prefix_length;
+        std::vector<node> &nodes = rule.network.is_ipv4() ? v4_nodes : v6_nodes;
+
+        if (prefix == 0)
+        {
+            (rule.network.is_ipv4() ? v4_default_rule : v6_default_rule) = rule_index;
+            return;
+        }
+
+        int level = (prefix - 1) / 4;
+        uint32_t n = 0;
+        for (int i = 0; i < level; ++i)
+        {
+            unsigned v = nibble(bytes, i);
+            if (nodes[n].slots[v].child == 0)
+            {
+                uint32_t child = static_cast<uint32_t>(nodes.size());
+                nodes.emplace_back(); // May move the nodes: index again below
+                nodes[n].slots[v].child = child;
+            }
+            n = nodes[n].slots[v].child;
+        }
+
+        int fixed = prefix - 4 * level;
+        unsigned first = nibble(bytes, level) & (0xfu << (4 - fixed)) & 0xfu;
+        unsigned count = 1u << (4 - fixed);
+        for (unsigned v = first; v < first + count; ++v)
+        {
+            slot &s = nodes[n].slots[v];
+            if (s.rule_prefix <= prefix)
+            {
+                s.rule = rule_index;
+                s.rule_prefix = prefix;
+            }
+        }
+    }
+
+    std::size_t ip_filter_rules::add(const ip_address &network, int prefix_length, ip_filter_action action)
+    {
+        if (network.empty())
+            throw socket_exception("Filter rule needs an IPv4 or IPv6 network address", "InvalidCidr", __func__);
+        if (prefix_length < 0)
+            throw socket_exception("Filter rule prefix length must not be negative", "InvalidCidr", __func__);
+
+        ip_filter_rule rule;
+        // Mapped networks are stored as IPv4, like the peers matched against them
+        rule.network = network.unmapped();
+        rule.prefix_length = std::min<int>(prefix_length - (network.is_v4_mapped() ? 96 : 0),
+                                           static_cast<int>(8 * rule.network.size()));
+        if (rule.prefix_length < 0)
+            rule.prefix_length = 0;
+        rule.action = action;
+
+        rules.push_back(rule);
+        hit_counts.emplace_back(0);
+        insert(static_cast<int32_t>(rules.size() - 1));
+        return rules.size() - 1;
+    }
+
+    std::size_t ip_filter_rules::add(const std::string &cidr, ip_filter_action action)
+    {
+        std::size_t slash = cidr.find('/');
+        std::size_t address_len = slash == std::string::npos ? cidr.size() : slash;
+
+        ip_address network;
+        if (!ip_address::parse(cidr.data(), address_len, network))
+            throw socket_exception("Invalid network address in filter rule: " + cidr, "InvalidCidr", __func__);
+
+        int prefix = static_cast<int>(8 * network.size());
+        if (slash != std::string::npos)
+        {
+            std::size_t digits = cidr.size() - slash - 1;
+            if (digits == 0 || digits > 3)
+                throw socket_exception("Invalid prefix length in filter rule: " + cidr, "InvalidCidr", __func__);
+            int value = 0;
+            for (std::size_t i = slash + 1; i < cidr.size(); ++i)
+            {
+                if (cidr[i] < '0' || cidr[i] > '9')
+                    throw socket_exception("Invalid prefix length in filter rule: " + cidr, "InvalidCidr", __func__);
+                value = value * 10 + (cidr[i] - '0');
+            }
+            if (value > prefix)
+                throw socket_exception("Prefix length longer than the address in filter rule: " + cidr, "InvalidCidr", __func__);
+            prefix = value;
+        }
+        return add(network, prefix, action);
+    }
+
+    int ip_filter_rules::match(const ip_address &address) const
+    {
+        ip_address peer = address.unmapped();
+        const std::vector<node> *nodes;
+        int best;
+        int levels;
+        if (peer.is_ipv4())
+        {
+            nodes = &v4_nodes;
+            best = v4_default_rule;
+            levels = 8;
+        }
+        else if (peer.is_ipv6())
+        {
+            nodes = &v6_nodes;
+            best = v6_default_rule;
+            levels = 32;
+        }
+        else
+            return -1;
+
+        const std::uint8_t *bytes = peer.data();
+        const node *table = nodes->data();
+        uint32_t n = 0;
+        for (int i = 0; i < levels; ++i)
+        {
+            const slot &s = table[n].slots[nibble(bytes, i)];
+            if (s.rule >= 0)
+                best = s.rule;
+            if (s.child == 0)
+                break;
+            n = s.child;
+        }
+        return best;
+    }
+
+    ip_filter_action ip_filter_rules::evaluate(const ip_address &address) const
+    {
+        int rule = match(address);
+        if (rule < 0)
+        {
+            default_hit_count.fetch_add(1, std::memory_order_relaxed);
+            return default_action;
+        }
+        hit_counts[static_cast<std::size_t>(rule)].fetch_add(1, std::memory_order_relaxed);
+        return rules[static_cast<std::size_t>(rule)].action;
+    }
+
+    ip_filter::ip_filter(std::shared_ptr<const ip_filter_rules> initial)
+        : rules(std::move(initial))
+    {
+    }
+
+    void ip_filter::set_rules(std::shared_ptr<const ip_filter_rules> next)
+    {
+        std::atomic_store(&rules, std::move(next));
+        version.fetch_add(1, std::memory_order_release);
+    }
+
+    std::shared_ptr<const ip_filter_rules> ip_filter::get_rules() const
+    {
+        return std::atomic_load(&rules);
+    }
+}
@@ -0,0 +1,158 @@
+/**
+ * @file ip_limiter.cpp
+ * @brief Implementation of the per-IP connection and accept-rate limiter
+ */
+
+#include <algorithm>
+
+#include "../includes/ip_limiter.hpp"
+
+namespace hh_socket
+{
+    namespace
+    {
+        /// Table size of a new or shrunk limiter
+        constexpr std::size_t MIN_TABLE_SIZE = 16;
+    }
+
+    ip_limiter::ip_limiter()
+        : table(MIN_TABLE_SIZE)
+    {
+    }
+
+    float ip_limiter::burst() const
+    {
+        if (limits.accept_burst >= 1)
+            return static_cast<float>(limits.accept_burst);
+        return static_cast<float>(std::max(1.0, limits.accepts_per_second));
+    }
+
+    float ip_limiter::tokens_at(const entry &e, uint32_t now_ms) const
+    {
+        if (limits.accepts_per_second <= 0)
+            return burst();
+        // Unsigned difference stays right across the 32-bit wrap (~49 days)
+        uint32_t elapsed = now_ms - e.last_refill;
+        double refilled = e.tokens + elapsed * limits.accepts_per_second / 1000.0;
+        return static_cast<float>(std::min<double>(refilled, burst()));
+    }
+
+    std::size_t ip_limiter::probe(const ip_address &address) const
+    {
+        std::size_t mask = table.size() - 1;
+        std::size_t i = address.hash() & mask;
+        // At most half full, so a free slot always ends the scan
+        while (!table[i].address.empty() && table[i].address != address)
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    /**
+     * Algorithm:
+     * 1. Keeps the entries that still carry state: open connections, or a
+     *    bucket that has not refilled yet
+     * 2. Sizes the new table so those fill at most a quarter of it, which
+     *    leaves room for as many new addresses before the next compaction
+     *    and shrinks the table again after a flood from many addresses
+     * 3. Re-inserts the kept entries
+     *
+     * Linear probing cannot simply clear a slot in the middle of a probe
+     * chain, so idle entries are only ever dropped here, all at once.
+     */
+    void ip_limiter::compact(uint32_t now_ms)
+    {
+        std::vector<entry> kept;
+        float full = burst();
+        for (const entry &e : table)
+            if (!e.address.empty() && (e.connections > 0 || tokens_at(e, now_ms) < full))
+                kept.push_back(e);
+
+        std::size_t size = MIN_TABLE_SIZE;
+        while ((kept.size() + 1) * 4 > size)
+            size *= 2;
+
+        table.assign(size, entry());
+        for (const entry &e : kept)
+            table[probe(e.address)] = e;
+        used = kept.size();
+    }
+
+    ip_limiter::entry &ip_limiter::find_or_insert(const ip_address &peer, uint32_t now_ms)
+    {
+        std::size_t i = probe(peer);
+        if (table[i].address.empty())
+        {
+            if ((used + 1) * 2 > table.size())
+            {
+                compact(now_ms);
+                i = probe(peer);
+            }
+            entry &fresh = table[i];
+            fresh.address = peer;
+            fresh.connections = 0;
+            fresh.tokens = burst();
+            fresh.last_refill = now_ms;
+            ++used;
+        }
+        return table[i];
+    }
+
+    bool ip_limiter::admit(const ip_address &address, uint64_t now_ms)
+    {
+        if (!active())
+            return true;
+        ip_address peer = address.unmapped();
+        if (peer.empty())
+            return true; // Not an IP peer (e.g. a Unix socket): nothing to key on
+
+        uint32_t now = static_cast<uint32_t>(now_ms);
+        entry &e = find_or_insert(peer, now);
+        if (limits.max_connections_per_ip > 0 && e.connections >= limits.max_connections_per_ip)
+        {
+            ++stats.over_connections;
+            return false;
+        }
+        if (limits.accepts_per_second > 0)
+        {
+            float tokens = tokens_at(e, now);
+            e.last_refill = now;
+            if (tokens < 1)
+            {
+                e.tokens = tokens;
+                ++stats.over_rate;
+                return false;
+            }
+            e.tokens = tokens - 1;
+        }
+        ++e.connections;
+        return true;
+    }
+
+    void ip_limiter::release(const ip_address &address)
+    {
+        ip_address peer = address.unmapped();
+        if (peer.empty())
+            return;
+        entry &e = table[probe(peer)];
+        if (!e.address.empty() && e.connections > 0)
+            --e.connections;
+    }
+
+    void ip_limiter::track(const ip_address &address, uint64_t now_ms)
+    {
+        if (!active())
+            return;
+        ip_address peer = address.unmapped();
+        if (peer.empty())
+            return;
+        ++find_or_insert(peer, static_cast<uint32_t>(now_ms)).connections;
+    }
+
+    uint32_t ip_limiter::connections(const ip_address &address) const
+    {
+        ip_address peer = address.unmapped();
+        if (peer.empty())
+            return 0;
+        return table[probe(peer)].connections;
+    }
+}
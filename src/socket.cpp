@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <cstring>
@@ -17,6 +18,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -28,6 +30,7 @@
 #include "../includes/socket.hpp"
 #include "../includes/file_descriptor.hpp"
 #include "../includes/utilities.hpp"
+#include "../includes/buffer_pool.hpp"
 #include "../includes/exceptions.hpp"
 
 namespace hh_socket
@@ -215,6 +218,10 @@ namespace hh_socket
      * Uses ::recvfrom() system call to receive datagram and sender information.
      * UDP is connectionless - can receive from any sender.
      * Buffer size is set to 64KB to handle maximum UDP payload size.
+     * The datagram is received into a block from a per-thread pool. Large
+     * datagrams are returned as a slice of it without a copy; those under a
+     * quarter of the block are copied out so a retained buffer does not pin
+     * 64KB.
      */
     data_buffer socket::receive(socket_address &client_addr)
     {
@@ -228,13 +235,14 @@ namespace hh_socket
         sockaddr_storage sender_addr;
         socklen_t sender_addr_len = sizeof(sender_addr);
 
-        // Use 64KB buffer for UDP - theoretical max UDP payload is 65507 bytes
-        char buffer[MAX_BUFFER_SIZE];
+        // Use 64KB blocks for UDP - theoretical max UDP payload is 65507 bytes
+        buffer_pool &receive_pool = thread_receive_pool();
+        std::shared_ptr<std::string> block = receive_pool.acquire();
 
         // ::recvfrom(sockfd, buf, len, flags, src_addr, addrlen) - receive datagram
         // Returns number of bytes received, -1 on error
         // Fills sender_addr with sender's address information
-        std::size_t bytes_received = ::recvfrom(fd.get(), buffer, sizeof(buffer), 0,
+        std::size_t bytes_received = ::recvfrom(fd.get(), &(*block)[0], static_cast<int>(block->size()), 0,
                                                 reinterpret_cast<sockaddr *>(&sender_addr), &sender_addr_len);
 
         if (bytes_received == SOCKET_ERROR_VALUE)
@@ -244,7 +252,7 @@ namespace hh_socket
 
         // Extract sender's address and return received data
         client_addr = socket_address(sender_addr);
-        return data_buffer(buffer, static_cast<std::size_t>(bytes_received));
+        return receive_pool.take(std::move(block), static_cast<std::size_t>(bytes_received));
     }
 
     /**
@@ -280,6 +288,275 @@ namespace hh_socket
         }
     }
 
+    /**
+     * Receives a batch of datagrams into preallocated slots.
+     *
+     * Algorithm (Linux):
+     * 1. Reset the lengths the previous call or push() changed
+     * 2. One recvmmsg() over every slot with MSG_WAITFORONE, so a blocking
+     *    socket returns as soon as one datagram arrived instead of waiting
+     *    for the whole batch
+     * 3. EAGAIN on a non-blocking socket is an empty batch, not an error
+     *
+     * The kernel writes each payload, sender address, length and MSG_TRUNC
+     * flag straight into the batch, so nothing is copied or allocated.
+     */
+    std::size_t socket::receive_batch(datagram_batch &batch)
+    {
+        if (protocol != Protocol::UDP)
+        {
+            throw socket_exception("receive_batch is only supported for UDP sockets", "ProtocolMismatch", __func__);
+        }
+
+        batch.prepare_receive();
+
+#if defined(__linux__) || defined(__linux)
+        int received;
+        do
+        {
+            received = ::recvmmsg(fd.get(), batch.headers.data(), static_cast<unsigned>(batch.headers.size()),
+                                  MSG_WAITFORONE, nullptr);
+        } while (received < 0 && errno == EINTR);
+
+        if (received < 0)
+        {
+            if (errno == SOCKET_AGAIN || errno == SOCKET_WOULDBLOCK)
+                return 0;
+            throw socket_exception("Failed to receive data: " + std::string(get_error_message()), "SocketReceive", __func__);
+        }
+
+        batch.count = static_cast<std::size_t>(received);
+        return batch.count;
+#else
+        // No recvmmsg(): one datagram per call, into slot 0
+        socklen_t addr_len = sizeof(sockaddr_storage);
+        int received = ::recvfrom(fd.get(), batch.data(0), static_cast<int>(batch.slot_bytes), 0,
+                                  reinterpret_cast<sockaddr *>(&batch.addrs[0]), &addr_len);
+        bool truncated = false;
+        if (received == SOCKET_ERROR_VALUE)
+        {
+            int err = socket_errno();
+            if (err == SOCKET_AGAIN || err == SOCKET_WOULDBLOCK)
+                return 0;
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+            if (err != WSAEMSGSIZE)
+#endif
+                throw socket_exception("Failed to receive data: " + std::string(get_error_message()), "SocketReceive", __func__);
+            // Windows reports a datagram larger than the slot as WSAEMSGSIZE
+            received = static_cast<int>(batch.slot_bytes);
+            truncated = true;
+        }
+
+        batch.lengths[0] = static_cast<std::size_t>(received);
+        batch.addr_lens[0] = addr_len;
+        batch.truncs[0] = truncated;
+        batch.count = 1;
+        return 1;
+#endif
+    }
+
+    /**
+     * Sends every datagram of a batch.
+     *
+     * Algorithm (Linux):
+     * 1. sendmmsg() over the slots not sent yet
+     * 2. The kernel may stop early (e.g. on a signal or a full buffer after
+     *    some datagrams); continue from the first unsent slot
+     * 3. EAGAIN on a non-blocking socket stops and reports how many were sent
+     */
+    std::size_t socket::send_batch(datagram_batch &batch)
+    {
+        if (protocol != Protocol::UDP)
+        {
+            throw socket_exception("send_batch is only supported for UDP sockets", "ProtocolMismatch", __func__);
+        }
+
+        std::size_t sent = 0;
+        while (sent < batch.count)
+        {
+#if defined(__linux__) || defined(__linux)
+            int n = ::sendmmsg(fd.get(), batch.headers.data() + sent, static_cast<unsigned>(batch.count - sent), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+#else
+            int n = ::sendto(fd.get(), batch.data(sent), static_cast<int>(batch.lengths[sent]), 0,
+                             batch.address(sent), batch.addr_lens[sent]);
+            if (n != SOCKET_ERROR_VALUE)
+                n = 1;
+#endif
+            if (n < 0)
+            {
+                int err = socket_errno();
+                if (err == SOCKET_AGAIN || err == SOCKET_WOULDBLOCK)
+                    break;
+                throw socket_exception("Failed to send data: " + std::string(get_error_message()), "SocketSend", __func__);
+            }
+            sent += static_cast<std::size_t>(n);
+        }
+        return sent;
+    }
+
+    /**
+     * Sends a buffer as equal-sized datagrams.
+     *
+     * Algorithm (Linux with UDP_SEGMENT):
+     * 1. Cut the buffer into chunks of at most 64 segments (the kernel's
+     *    UDP_MAX_SEGMENTS) and at most 65507 bytes (the largest UDP payload)
+     * 2. Send each chunk with one sendmsg() carrying a UDP_SEGMENT control
+     *    message; a chunk of a single segment needs none
+     * 3. If the kernel refuses the option (old kernel, segment larger than
+     *    the path MTU allows, no checksum offload), set gso_rejected and
+     *    send the rest one datagram at a time
+     */
+    bool socket::send_segments(const socket_address &addr, const data_buffer &data, std::size_t segment_size)
+    {
+        if (protocol != Protocol::UDP)
+        {
+            throw socket_exception("send_segments is only supported for UDP sockets", "ProtocolMismatch", __func__);
+        }
+        if (segment_size == 0)
+        {
+            throw socket_exception("Segment size must be greater than 0", "InvalidArgument", __func__);
+        }
+
+        const char *p = data.data();
+        std::size_t left = data.size();
+        bool offloaded = false;
+
+#if defined(UDP_SEGMENT)
+        const std::size_t max_payload = 65507;
+        const std::size_t max_segments = 64;
+        std::size_t per_call = std::min(max_segments, max_payload / segment_size) * segment_size;
+
+        while (!gso_rejected && per_call > segment_size && left > segment_size)
+        {
+            std::size_t chunk = std::min(left, per_call);
+            iovec iov{const_cast<char *>(p), chunk};
+
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+            msghdr msg{};
+            msg.msg_name = addr.get_sock_addr();
+            msg.msg_namelen = addr.get_sock_addr_len();
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gso_size = static_cast<uint16_t>(segment_size);
+            std::memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+
+            ssize_t n = ::sendmsg(fd.get(), &msg, 0);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EINVAL || errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+                {
+                    gso_rejected = true;
+                    break;
+                }
+                throw socket_exception("Failed to send data: " + std::string(get_error_message()), "SocketSend", __func__);
+            }
+            offloaded = true;
+            p += chunk;
+            left -= chunk;
+        }
+#endif
+
+        // Per-datagram path: fallback, the tail of a send, or no UDP_SEGMENT
+        while (left > 0)
+        {
+            std::size_t len = std::min(left, segment_size);
+            auto sent = ::sendto(fd.get(), p, static_cast<int>(len), 0, addr.get_sock_addr(), addr.get_sock_addr_len());
+            if (sent == SOCKET_ERROR_VALUE)
+            {
+                throw socket_exception("Failed to send data: " + std::string(get_error_message()), "SocketSend", __func__);
+            }
+            p += len;
+            left -= len;
+        }
+        return offloaded;
+    }
+
+    /**
+     * Enables UDP_GRO so the kernel may hand several datagrams of one flow
+     * to a single receive. Failure only means no coalescing, so it is
+     * reported instead of thrown.
+     */
+    bool socket::set_gro(bool enable)
+    {
+        if (protocol != Protocol::UDP)
+        {
+            throw socket_exception("set_gro is only supported for UDP sockets", "ProtocolMismatch", __func__);
+        }
+#if defined(UDP_GRO)
+        int optval = enable ? 1 : 0;
+        return ::setsockopt(fd.get(), SOL_UDP, UDP_GRO, &optval, sizeof(optval)) == 0;
+#else
+        (void)enable;
+        return false;
+#endif
+    }
+
+    /**
+     * Receives a datagram, or several coalesced by GRO.
+     *
+     * Same as receive(socket_address &) but through recvmsg(), so the
+     * UDP_GRO control message carrying the segment size can be read. Without
+     * that message the buffer holds exactly one datagram.
+     */
+    data_buffer socket::receive(socket_address &client_addr, std::size_t &segment_size)
+    {
+#if defined(UDP_GRO)
+        if (protocol != Protocol::UDP)
+        {
+            throw socket_exception("receive is only supported for UDP sockets", "ProtocolMismatch", __func__);
+        }
+
+        sockaddr_storage sender_addr;
+        buffer_pool &receive_pool = thread_receive_pool();
+        std::shared_ptr<std::string> block = receive_pool.acquire();
+
+        iovec iov{&(*block)[0], block->size()};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        msghdr msg{};
+        msg.msg_name = &sender_addr;
+        msg.msg_namelen = sizeof(sender_addr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t bytes_received = ::recvmsg(fd.get(), &msg, 0);
+        if (bytes_received < 0)
+        {
+            throw socket_exception("Failed to receive data: " + std::string(get_error_message()), "SocketReceive", __func__);
+        }
+
+        segment_size = static_cast<std::size_t>(bytes_received);
+        for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+            {
+                int gso_size;
+                std::memcpy(&gso_size, CMSG_DATA(cm), sizeof(gso_size));
+                if (gso_size > 0)
+                    segment_size = static_cast<std::size_t>(gso_size);
+            }
+        }
+
+        client_addr = socket_address(sender_addr);
+        return receive_pool.take(std::move(block), static_cast<std::size_t>(bytes_received));
+#else
+        data_buffer data = receive(client_addr);
+        segment_size = data.size();
+        return data;
+#endif
+    }
+
     /**
      * returns the bound local address.
      */
@@ -363,6 +640,27 @@ namespace hh_socket
         }
     }
 
+    /**
+     * Sets SO_REUSEPORT socket option so several listeners can share one port.
+     * On Linux the kernel hashes incoming connections across all sockets in the
+     * reuseport group, which is what lets each event loop own its own listener.
+     * Windows has no equivalent option, so the call fails there.
+     */
+    void socket::set_reuse_port(bool reuse)
+    {
+#if defined(SO_REUSEPORT)
+        int optval = reuse ? 1 : 0;
+        const char *optval_ptr = reinterpret_cast<const char *>(&optval);
+        if (setsockopt(fd.get(), SOL_SOCKET, SO_REUSEPORT, optval_ptr, sizeof(optval)) == SOCKET_ERROR_VALUE)
+        {
+            throw socket_exception("Failed to set SO_REUSEPORT option: " + std::string(get_error_message()), "SocketOption", __func__);
+        }
+#else
+        (void)reuse;
+        throw socket_exception("SO_REUSEPORT is not supported on this platform", "SocketOption", __func__);
+#endif
+    }
+
     /**
      * Sets socket to non-blocking or blocking mode.
      * Non-blocking sockets return immediately from I/O operations even if no data
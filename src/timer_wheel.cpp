@@ -0,0 +1,274 @@
+/**
+ * @file timer_wheel.cpp
+ * @brief Implementation of the hierarchical timing wheel
+ */
+
+#include <chrono>
+#include <climits>
+
+#include "../includes/timer_wheel.hpp"
+
+namespace hh_socket
+{
+    namespace
+    {
+        /// Index of the lowest set bit, mask must be non-zero
+        unsigned lowest_bit(uint64_t mask)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+            unsigned bit = 0;
+            while (!(mask & 1))
+            {
+                mask >>= 1;
+                ++bit;
+            }
+            return bit;
+#endif
+        }
+    }
+
+    // ============================================================================
+    // timer
+    // ============================================================================
+
+    timer::timer(timer &&other) noexcept
+    {
+        take_over(other);
+    }
+
+    timer &timer::operator=(timer &&other) noexcept
+    {
+        if (this != &other)
+        {
+            cancel();
+            take_over(other);
+        }
+        return *this;
+    }
+
+    void timer::take_over(timer &other)
+    {
+        prev = other.prev;
+        next = other.next;
+        wheel = other.wheel;
+        level = other.level;
+        index = other.index;
+        expires = other.expires;
+        period = other.period;
+        callback = std::move(other.callback);
+
+        // Take over other's place in its slot list
+        if (wheel)
+        {
+            if (prev)
+                prev->next = this;
+            else
+                wheel->slots[level][index] = this;
+            if (next)
+                next->prev = this;
+        }
+        other.prev = other.next = nullptr;
+        other.wheel = nullptr;
+    }
+
+    void timer::cancel()
+    {
+        if (wheel)
+            wheel->unlink(*this);
+    }
+
+    // ============================================================================
+    // timer_wheel
+    // ============================================================================
+
+    timer_wheel::timer_wheel() : current(clock_ms())
+    {
+    }
+
+    timer_wheel::~timer_wheel()
+    {
+        for (unsigned level = 0; level < LEVELS; ++level)
+            for (unsigned index = 0; index < LEVEL_SIZE; ++index)
+                while (slots[level][index])
+                    unlink(*slots[level][index]);
+    }
+
+    uint64_t timer_wheel::clock_ms()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    /**
+     * Level Selection:
+     * The timer goes to the lowest level whose enclosing block (the range
+     * covered by one slot of the level above) also contains the current
+     * tick. Its slot index is then always ahead of the wheel's position at
+     * that level, so it is reached (and cascaded or fired) exactly once.
+     */
+    void timer_wheel::link(timer &t, uint64_t at)
+    {
+        unsigned level = 0;
+        while (level < LEVELS - 1 &&
+               (at >> (LEVEL_BITS * (level + 1))) != (current >> (LEVEL_BITS * (level + 1))))
+            ++level;
+        unsigned index = static_cast<unsigned>(at >> (LEVEL_BITS * level)) & (LEVEL_SIZE - 1);
+
+        t.level = static_cast<uint8_t>(level);
+        t.index = static_cast<uint8_t>(index);
+        t.prev = nullptr;
+        t.next = slots[level][index];
+        if (t.next)
+            t.next->prev = &t;
+        slots[level][index] = &t;
+        occupied[level] |= 1ULL << index;
+        t.wheel = this;
+        ++armed_count;
+    }
+
+    void timer_wheel::unlink(timer &t)
+    {
+        if (t.prev)
+            t.prev->next = t.next;
+        else
+            slots[t.level][t.index] = t.next;
+        if (t.next)
+            t.next->prev = t.prev;
+        if (!slots[t.level][t.index])
+            occupied[t.level] &= ~(1ULL << t.index);
+        t.prev = t.next = nullptr;
+        t.wheel = nullptr;
+        --armed_count;
+    }
+
+    void timer_wheel::cascade(unsigned level, unsigned index)
+    {
+        // Detach the whole list first: timers clamped to the top level may
+        // land in this very slot again
+        timer *t = slots[level][index];
+        slots[level][index] = nullptr;
+        occupied[level] &= ~(1ULL << index);
+        while (t)
+        {
+            timer *following = t->next;
+            --armed_count;
+            t->wheel = nullptr;
+            link(*t, t->expires > current ? t->expires : current);
+            t = following;
+        }
+    }
+
+    void timer_wheel::schedule(timer &t, uint64_t delay_ms)
+    {
+        if (t.wheel)
+            t.wheel->unlink(t);
+        t.period = 0;
+        t.expires = current + delay_ms;
+        link(t, t.expires > current ? t.expires : current + 1);
+    }
+
+    void timer_wheel::schedule_every(timer &t, uint64_t period_ms)
+    {
+        if (t.wheel)
+            t.wheel->unlink(t);
+        t.period = period_ms ? period_ms : 1;
+        t.expires = current + t.period;
+        link(t, t.expires);
+    }
+
+    void timer_wheel::schedule_at(timer &t, uint64_t when_ms)
+    {
+        if (t.wheel)
+            t.wheel->unlink(t);
+        t.period = 0;
+        t.expires = when_ms;
+        link(t, when_ms > current ? when_ms : current + 1);
+    }
+
+    void timer_wheel::cancel(timer &t)
+    {
+        if (t.wheel == this)
+            unlink(t);
+    }
+
+    /**
+     * Algorithm, for every tick up to now_ms:
+     * 1. When the low bits of the tick wrap, cascade the matching slot of
+     *    each higher level, highest first, so its timers reach level 0
+     * 2. Fire every timer in the level-0 slot of the tick, one at a time, so
+     *    callbacks may freely arm or cancel other timers
+     * 3. Periodic timers are re-armed before their callback runs
+     *
+     * With no timer armed the wheel just jumps to now_ms.
+     */
+    std::size_t timer_wheel::advance(uint64_t now_ms)
+    {
+        std::size_t fired = 0;
+        while (current < now_ms)
+        {
+            if (armed_count == 0)
+            {
+                current = now_ms;
+                break;
+            }
+            ++current;
+
+            unsigned index = static_cast<unsigned>(current) & (LEVEL_SIZE - 1);
+            if (index == 0)
+            {
+                unsigned top = 1;
+                while (top < LEVELS - 1 && ((current >> (LEVEL_BITS * top)) & (LEVEL_SIZE - 1)) == 0)
+                    ++top;
+                for (unsigned level = top; level >= 1; --level)
+                    cascade(level, static_cast<unsigned>(current >> (LEVEL_BITS * level)) & (LEVEL_SIZE - 1));
+            }
+
+            while (timer *t = slots[0][index])
+            {
+                unlink(*t);
+                ++fired;
+                if (t->period)
+                {
+                    t->expires = current + t->period;
+                    link(*t, t->expires);
+                }
+                if (t->callback)
+                    t->callback();
+            }
+        }
+        return fired;
+    }
+
+    int timer_wheel::next_timeout(int max_timeout) const
+    {
+        if (armed_count == 0)
+            return max_timeout;
+
+        uint64_t best = UINT64_MAX;
+        for (unsigned level = 0; level < LEVELS; ++level)
+        {
+            uint64_t mask = occupied[level];
+            if (!mask)
+                continue;
+            unsigned shift = LEVEL_BITS * level;
+            uint64_t pos = current >> shift;
+            unsigned position = static_cast<unsigned>(pos) & (LEVEL_SIZE - 1);
+            uint64_t base = pos & ~static_cast<uint64_t>(LEVEL_SIZE - 1);
+
+            // Slots after the current position in this round, else the next round
+            uint64_t ahead = position == LEVEL_SIZE - 1 ? 0 : mask & (~0ULL << (position + 1));
+            uint64_t when = ahead ? (base + lowest_bit(ahead)) << shift
+                                  : (base + LEVEL_SIZE + lowest_bit(mask)) << shift;
+            if (when < best)
+                best = when;
+        }
+
+        uint64_t delta = best > current ? best - current : 0;
+        if (max_timeout >= 0 && delta > static_cast<uint64_t>(max_timeout))
+            return max_timeout;
+        return delta > static_cast<uint64_t>(INT_MAX) ? INT_MAX : static_cast<int>(delta);
+    }
+}
@@ -153,78 +153,45 @@ namespace hh_socket
     }
 
     /**
-     * Convert IP address string to binary network format.
-     * Handles both IPv4 and IPv6 addresses with platform-specific implementations.
-     * Uses inet_pton() on Unix/Linux and InetPtonA() on Windows for compatibility.
+     * Copy an IP address into a binary network-format buffer.
+     * The address was already parsed by ip_address, so no inet_pton() runs.
+     * An IPv4 address written for the IPv6 family becomes ::ffff:a.b.c.d.
+     * Mismatched or empty addresses leave the buffer untouched.
      */
     void convert_ip_address_to_network_order(const family &family_ip, const ip_address &address, void *addr)
     {
-#if defined(SOCKET_PLATFORM_WINDOWS)
-        // Windows implementation using InetPtonA() function
-        if (family_ip == family(IPV4))
+        if (family_ip.get() == IPV4)
         {
-            // Convert IPv4 address string to binary format
-            IN_ADDR in_addr;
-            if (InetPtonA(AF_INET, address.get().c_str(), &in_addr) == 1)
-            {
-                // Copy converted address to output buffer
-                *(reinterpret_cast<IN_ADDR *>(addr)) = in_addr;
-            }
-            // Note: No error handling for conversion failure
+            ip_address v4 = address.unmapped();
+            if (v4.is_ipv4())
+                std::memcpy(addr, v4.data(), 4);
         }
-        else if (family_ip == family(IPV6))
+        else if (family_ip.get() == IPV6)
         {
-            // Convert IPv6 address string to binary format
-            IN6_ADDR in6_addr;
-            if (InetPtonA(AF_INET6, address.get().c_str(), &in6_addr) == 1)
+            if (address.is_ipv6())
+            {
+                std::memcpy(addr, address.data(), 16);
+            }
+            else if (address.is_ipv4())
             {
-                // Copy converted address to output buffer
-                *(reinterpret_cast<IN6_ADDR *>(addr)) = in6_addr;
+                // IPv4-mapped IPv6 address, for dual-stack sockets
+                std::uint8_t *out = static_cast<std::uint8_t *>(addr);
+                std::memset(out, 0, 10);
+                out[10] = out[11] = 0xff;
+                std::memcpy(out + 12, address.data(), 4);
             }
-            // Note: No error handling for conversion failure
         }
-#else
-        // Unix/Linux implementation using standard inet_pton()
-        // Handles both IPv4 and IPv6 based on family parameter
-        // Returns 1 on success, 0 for invalid format, -1 for unsupported family
-        inet_pton(family_ip.get(), address.get().c_str(), addr);
-        // Note: Return value not checked - caller should validate
-#endif
     }
 
     /**
      * Extract human-readable IP address from network address structure.
-     * Supports both IPv4 and IPv6 addresses using inet_ntop() for conversion.
+     * Supports both IPv4 and IPv6 addresses; formatting is done by ip_address.
      * Uses sockaddr_storage for generic address storage across address families.
      */
-    std::string get_ip_address_from_network_address(struct sockaddr_storage &addr)
+    std::string get_ip_address_from_network_address(const struct sockaddr_storage &addr)
     {
-        // Buffer large enough for both IPv4 and IPv6 string representations
-        // INET6_ADDRSTRLEN = 46 bytes (maximum IPv6 string length)
-        char ip_str[INET6_ADDRSTRLEN];
-
-        if (addr.ss_family == AF_INET)
-        {
-            // Handle IPv4 address conversion
-            // Cast generic storage to IPv4-specific structure
-            sockaddr_in *addr_in = reinterpret_cast<sockaddr_in *>(&addr);
-
-            // Convert binary IPv4 address to string format
-            inet_ntop(AF_INET, &addr_in->sin_addr, ip_str, sizeof(ip_str));
-        }
-        else if (addr.ss_family == AF_INET6)
-        {
-            // Handle IPv6 address conversion
-            // Cast generic storage to IPv6-specific structure
-            sockaddr_in6 *addr_in6 = reinterpret_cast<sockaddr_in6 *>(&addr);
-
-            // Convert binary IPv6 address to string format
-            inet_ntop(AF_INET6, &addr_in6->sin6_addr, ip_str, sizeof(ip_str));
-        }
-
-        // Return string representation of IP address
-        // Returns empty/garbage string if conversion fails or unsupported family
-        return std::string(ip_str);
+        // Empty string for unsupported families
+        return ip_address::from_sockaddr(addr).get();
     }
 
     /**
@@ -435,13 +402,15 @@ namespace hh_socket
         return upper_case_str;
     }
 
-    std::shared_ptr<hh_socket::socket> make_listener_socket(uint16_t port, const std::string &ip, int backlog)
+    std::shared_ptr<hh_socket::socket> make_listener_socket(uint16_t port, const std::string &ip, int backlog, bool reuse_port)
     {
         try
         {
             auto sock_ptr = std::make_shared<hh_socket::socket>(hh_socket::Protocol::TCP);
 
             sock_ptr->set_reuse_address(true);
+            if (reuse_port)
+                sock_ptr->set_reuse_port(true);
             sock_ptr->set_non_blocking(true);
             sock_ptr->set_close_on_exec(true);
             sock_ptr->bind(hh_socket::socket_address(hh_socket::port(port), hh_socket::ip_address(ip)));
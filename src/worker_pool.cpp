@@ -0,0 +1,233 @@
+/**
+ * @file worker_pool.cpp
+ * @brief Implementation of the work-stealing worker pool
+ */
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+#include "../includes/worker_pool.hpp"
+
+namespace hh_socket
+{
+    namespace
+    {
+        /// Tasks a strand runs before handing its thread to other work
+        constexpr std::size_t STRAND_BATCH = 64;
+
+        /// Index of the calling thread's queue in the pool it works for
+        thread_local const worker_pool *current_pool = nullptr;
+        thread_local std::size_t current_index = 0;
+    }
+
+    worker_pool::worker_pool(std::size_t threads)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 0; i < threads; ++i)
+            queues.push_back(std::make_unique<worker_queue>());
+        workers.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i)
+            workers.emplace_back([this, i]
+                                 { work(i); });
+    }
+
+    worker_pool::~worker_pool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(idle_lock);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto &t : workers)
+            t.join();
+    }
+
+    void worker_pool::count_submitted()
+    {
+        submitted.fetch_add(1, std::memory_order_relaxed);
+        unfinished.fetch_add(1, std::memory_order_relaxed);
+        std::size_t depth = queued.fetch_add(1, std::memory_order_relaxed) + 1;
+        std::size_t seen = max_queued.load(std::memory_order_relaxed);
+        while (depth > seen && !max_queued.compare_exchange_weak(seen, depth, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void worker_pool::execute(task &t)
+    {
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        try
+        {
+            t();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "worker_pool task failed: " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "worker_pool task failed with an unknown exception" << std::endl;
+        }
+        t = nullptr; // Release captures before the task counts as finished
+        executed.fetch_add(1, std::memory_order_relaxed);
+        if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::lock_guard<std::mutex> guard(idle_lock);
+            idle.notify_all();
+        }
+    }
+
+    /**
+     * Wakeup Protocol:
+     * A worker about to sleep registers in sleepers, then re-checks items
+     * under idle_lock. A submitter bumps items, then reads sleepers. With
+     * sequentially consistent operations at least one side sees the other,
+     * so either the worker finds the item or the submitter notifies it.
+     * Submitters skip the lock entirely while every worker is busy.
+     */
+    void worker_pool::schedule(task item)
+    {
+        std::size_t index = current_pool == this ? current_index
+                                                 : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        {
+            std::lock_guard<std::mutex> guard(queues[index]->lock);
+            queues[index]->items.push_back(std::move(item));
+        }
+        items.fetch_add(1);
+        if (sleepers.load() > 0)
+        {
+            {
+                std::lock_guard<std::mutex> guard(idle_lock);
+            }
+            wakeup.notify_one();
+        }
+    }
+
+    void worker_pool::submit(task t)
+    {
+        count_submitted();
+        schedule([this, t = std::move(t)]() mutable
+                 { execute(t); });
+    }
+
+    std::shared_ptr<worker_pool::strand> worker_pool::make_strand()
+    {
+        return std::shared_ptr<strand>(new strand(*this));
+    }
+
+    void worker_pool::submit(strand &s, task t)
+    {
+        count_submitted();
+        bool start;
+        {
+            std::lock_guard<std::mutex> guard(s.lock);
+            s.tasks.push_back(std::move(t));
+            start = !s.scheduled;
+            s.scheduled = true;
+        }
+        if (start)
+            schedule([self = s.shared_from_this()]
+                     { self->run(); });
+    }
+
+    void worker_pool::strand::run()
+    {
+        for (std::size_t n = 0; n < STRAND_BATCH; ++n)
+        {
+            task t;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (tasks.empty())
+                {
+                    scheduled = false;
+                    return;
+                }
+                t = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            pool.execute(t);
+        }
+        // Batch used up: queue again behind the work that waited meanwhile
+        pool.schedule([self = shared_from_this()]
+                      { self->run(); });
+    }
+
+    std::size_t worker_pool::strand::pending()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return tasks.size();
+    }
+
+    bool worker_pool::take(std::size_t self, task &out)
+    {
+        {
+            worker_queue &own = *queues[self];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.items.empty())
+            {
+                out = std::move(own.items.front());
+                own.items.pop_front();
+                items.fetch_sub(1);
+                return true;
+            }
+        }
+        for (std::size_t k = 1; k < queues.size(); ++k)
+        {
+            worker_queue &victim = *queues[(self + k) % queues.size()];
+            std::unique_lock<std::mutex> guard(victim.lock, std::try_to_lock);
+            if (!guard.owns_lock() || victim.items.empty())
+                continue;
+            out = std::move(victim.items.back());
+            victim.items.pop_back();
+            items.fetch_sub(1);
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void worker_pool::work(std::size_t self)
+    {
+        current_pool = this;
+        current_index = self;
+        task item;
+        while (true)
+        {
+            if (take(self, item))
+            {
+                item();
+                item = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(idle_lock);
+            sleepers.fetch_add(1);
+            // A try_lock in take() may have skipped a busy queue: only
+            // sleep when the item count says everything is drained
+            wakeup.wait(guard, [this]
+                        { return stopping.load() || items.load() > 0; });
+            sleepers.fetch_sub(1);
+            if (stopping)
+                return;
+        }
+    }
+
+    void worker_pool::wait_idle()
+    {
+        std::unique_lock<std::mutex> guard(idle_lock);
+        idle.wait(guard, [this]
+                  { return unfinished.load(std::memory_order_acquire) == 0; });
+    }
+
+    worker_pool_stats worker_pool::get_stats() const
+    {
+        worker_pool_stats s;
+        s.queued = queued.load(std::memory_order_relaxed);
+        s.max_queued = max_queued.load(std::memory_order_relaxed);
+        s.submitted = submitted.load(std::memory_order_relaxed);
+        s.executed = executed.load(std::memory_order_relaxed);
+        s.stolen = stolen.load(std::memory_order_relaxed);
+        return s;
+    }
+}